@@ -18,57 +18,103 @@
 
 #include "Qarma.h"
 
+#include <QAbstractTableModel>
+#include <QAbstractScrollArea>
 #include <QAction>
+#include <QBitArray>
 #include <QBoxLayout>
 #include <QCalendarWidget>
 #include <QCheckBox>
+#include <QCollator>
 #include <QColorDialog>
 #include <QComboBox>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDate>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QDBusInterface>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDesktopWidget>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QDialogButtonBox>
 #include <QEvent>
 #include <QFileDialog>
+#include <QFileIconProvider>
+#include <QFileInfo>
 #include <QFontDialog>
 #include <QFormLayout>
+#include <QHeaderView>
 #include <QIcon>
+#include <QImageReader>
 #include <QInputDialog>
 #include <QLabel>
 #include <QLocale>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QPainter>
 #include <QProcess>
+#include <QProgressBar>
 #include <QProgressDialog>
+#include <QPointer>
 #include <QPropertyAnimation>
+#include <QRunnable>
 #include <QPushButton>
+#include <QSaveFile>
 #include <QScreen>
 #include <QScrollBar>
+#include <QSemaphore>
 #include <QSettings>
+#include <QSharedPointer>
 #include <QSlider>
 #include <QSocketNotifier>
+#include <QStandardPaths>
 #include <QStringBuilder>
 #include <QStringList>
+#include <QStringMatcher>
+#include <QStyle>
+#include <QTextBlock>
 #include <QTextBrowser>
+#include <QThread>
+#include <QThreadPool>
+#include <QTextCodec>
+#include <QTextCursor>
+#include <QTextDocument>
 #include <QTimer>
 #include <QTimerEvent>
+#include <QTreeView>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 
 #if QT_VERSION >= 0x050000
-// this is to hack access to the --title parameter in Qt5
 #include <QWindow>
 #endif
 
 #include <QtDebug>
 
+#include <algorithm>
 #include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <vector>
 
 #ifdef Q_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
+
+static pid_t gs_parentPid = 0; // the client's parent when serving from --daemon
+extern char **environ;
 #endif
 
 class InputGuard : public QObject
@@ -149,124 +195,226 @@ private:
 
 InputGuard *InputGuard::s_instance = NULL;
 
+// QARMA_TRACE=1 prints when the startup phases finish and when stdin is used up, in ms since main()
+class StartupTrace : public QObject
+{
+public:
+    static void start() {
+        s_enabled = qgetenv("QARMA_TRACE") == "1";
+        if (s_enabled)
+            s_timer.start();
+    }
+    static void mark(const char *phase) {
+        if (s_enabled)
+            fprintf(stderr, "qarma trace: %10.3f ms  %s\n", s_timer.nsecsElapsed()/1.0e6, phase);
+    }
+    static void watch(QWidget *w) {
+        if (s_enabled)
+            w->installEventFilter(new StartupTrace(w));
+    }
+protected:
+    StartupTrace(QObject *parent) : QObject(parent) {}
+    bool eventFilter(QObject *o, QEvent *e) {
+        if (e->type() == QEvent::Show) {
+            mark("shown");
+        } else if (e->type() == QEvent::Paint) {
+            mark("first paint");
+            o->removeEventFilter(this);
+            deleteLater();
+        }
+        return false;
+    }
+private:
+    static bool s_enabled;
+    static QElapsedTimer s_timer;
+};
+
+bool StartupTrace::s_enabled = false;
+QElapsedTimer StartupTrace::s_timer;
+
 #ifdef WS_X11
 #include <QX11Info>
 #include <X11/Xlib.h>
 #endif
 
-typedef QPair<QString, QString> Help;
-typedef QList<Help> HelpList;
-typedef QPair<QString, HelpList> CategoryHelp;
-typedef QMap<QString, CategoryHelp> HelpDict;
+// Options are matched with a switch over their FNV-1a hash, the case labels are computed by the
+// compiler (which also rejects colliding options) and a hit is confirmed with one Latin-1 compare.
+static constexpr quint32 optionHash(const char *s, quint32 h = 2166136261u)
+{
+    return *s ? optionHash(s + 1, (h ^ quint8(*s)) * 16777619u) : h;
+}
 
+static quint32 optionHash(const QString &s)
+{
+    quint32 h = 2166136261u;
+    for (const QChar &c : s)
+        h = (h ^ c.unicode()) * 16777619u;
+    return h;
+}
 
-Qarma::Qarma(int &argc, char **argv) : QApplication(argc, argv)
+Qarma::Qarma(int &argc, char **argv, bool deferred) : QApplication(argc, argv)
 , m_modal(false)
 , m_selectableLabel(false)
 , m_parentWindow(0)
 , m_timeout(0)
+, m_outputFormat(0)
 , m_notificationId(0)
+, m_progressValue(-1)
+, m_progressLabelPending(false)
+, m_progressTimer(NULL)
+, m_notifications(NULL)
+, m_notifyCall(NULL)
 , m_dialog(NULL)
 , m_type(Invalid)
 {
-    QStringList argList = QCoreApplication::arguments(); // arguments() is slow
+    StartupTrace::mark("QApplication");
+    if (!deferred)
+        dispatch(QCoreApplication::arguments()); // arguments() is slow
+}
+
+static inline void appendCanonical(QStringList &args, const QString &arg)
+{
+    const int split = arg.startsWith("--") ? arg.indexOf('=') : -1;
+    if (split > -1)
+        args << arg.left(split) << arg.mid(split+1);
+    else
+        args << arg;
+}
+
+// --args-from: arguments are NUL terminated or, with --args-netstrings, "<length>:<bytes>,"
+// They're canonicalized as they're read, there's no argv or QCoreApplication::arguments() copy.
+static bool readArgs(const QString &path, bool netstrings, QStringList &args)
+{
+    QFile file(path);
+    if (!(path == "-" ? file.open(stdin, QIODevice::ReadOnly) : file.open(QIODevice::ReadOnly)))
+        return false;
+    QByteArray buffer;
+    int pos = 0;
+    bool eof = false;
+    while (true) {
+        const char *data = buffer.constData();
+        if (netstrings) {
+            const int colon = buffer.indexOf(':', pos);
+            if (colon > -1) {
+                bool ok;
+                const int length = QByteArray::fromRawData(data + pos, colon - pos).toInt(&ok);
+                if (!ok || length < 0)
+                    return false;
+                if (buffer.size() > qint64(colon) + length + 1) { // colon + length overflows an int
+                    if (data[colon + length + 1] != ',')
+                        return false;
+                    appendCanonical(args, QString::fromLocal8Bit(data + colon + 1, length));
+                    pos = colon + length + 2;
+                    continue;
+                }
+            }
+        } else {
+            const int nul = buffer.indexOf('\0', pos);
+            if (nul > -1) {
+                appendCanonical(args, QString::fromLocal8Bit(data + pos, nul - pos));
+                pos = nul + 1;
+                continue;
+            }
+        }
+        if (eof)
+            break;
+        buffer.remove(0, pos);
+        pos = 0;
+        const QByteArray chunk = file.read(64 << 10);
+        eof = chunk.isEmpty();
+        buffer += chunk;
+    }
+    // a missing trailing NUL is fine, a truncated netstring is not
+    if (pos < buffer.size()) {
+        if (netstrings)
+            return false;
+        appendCanonical(args, QString::fromLocal8Bit(buffer.constData() + pos, buffer.size() - pos));
+    }
+    return true;
+}
+
+// splits "--option=value" and pulls in --args-from, argList.at(0) is the binary
+static bool canonicalArgs(const QStringList &argList, QStringList &args, QString &unreadable)
+{
+    const bool netstrings = argList.contains("--args-netstrings");
+    for (int i = 1; i < argList.count(); ++i) {
+        if (argList.at(i) == "--args-netstrings")
+            continue;
+        QString argsFrom;
+        if (argList.at(i) == "--args-from" && i + 1 < argList.count())
+            argsFrom = argList.at(++i);
+        else if (argList.at(i).startsWith("--args-from="))
+            argsFrom = argList.at(i).mid(12);
+        if (argsFrom.isNull()) {
+            appendCanonical(args, argList.at(i));
+        } else if (!readArgs(argsFrom, netstrings, args)) {
+            unreadable = argsFrom;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Qarma::dispatch(QStringList argList)
+{
     m_zenity = argList.at(0).endsWith("zenity");
     // make canonical list
     QStringList args;
+    args.reserve(argList.count());
     if (argList.at(0).endsWith("-askpass")) {
         argList.removeFirst();
         args << "--title" << tr("Enter Password") << "--password" << "--prompt" << argList.join(' ');
     } else {
-        for (int i = 1; i < argList.count(); ++i) {
-            if (argList.at(i).startsWith("--")) {
-                int split = argList.at(i).indexOf('=');
-                if (split > -1) {
-                    args << argList.at(i).left(split) << argList.at(i).mid(split+1);
-                } else {
-                    args << argList.at(i);
-                }
-            } else {
-                args << argList.at(i);
-            }
+        QString unreadable;
+        if (!canonicalArgs(argList, args, unreadable)) {
+            error("--args-from could not read " + unreadable);
+            return;
         }
     }
     argList.clear();
 
     if (!readGeneral(args))
         return;
+    StartupTrace::mark("arguments");
 
+#define DIALOG_OPTION(_OPT_, _TYPE_, _SHOW_) case optionHash(_OPT_): \
+                                            if (arg == QLatin1String(_OPT_)) { m_type = _TYPE_; error = _SHOW_; } break;
     char error = 1;
     foreach (const QString &arg, args) {
-        if (arg == "--calendar") {
-            m_type = Calendar;
-            error = showCalendar(args);
-        } else if (arg == "--entry") {
-            m_type = Entry;
-            error = showEntry(args);
-        } else if (arg == "--error") {
-            m_type = Error;
-            error = showMessage(args, 'e');
-        } else if (arg == "--info") {
-            m_type = Info;
-            error = showMessage(args, 'i');
-        } else if (arg == "--file-selection") {
-            m_type = FileSelection;
-            error = showFileSelection(args);
-        } else if (arg == "--list") {
-            m_type = List;
-            error = showList(args);
-        } else if (arg == "--notification") {
-            m_type = Notification;
-            error = showNotification(args);
-        } else if (arg == "--progress") {
-            m_type = Progress;
-            error = showProgress(args);
-        } else if (arg == "--question") {
-            m_type = Question;
-            error = showMessage(args, 'q');
-        } else if (arg == "--warning") {
-            m_type = Warning;
-            error = showMessage(args, 'w');
-        } else if (arg == "--scale") {
-            m_type = Scale;
-            error = showScale(args);
-        } else if (arg == "--text-info") {
-            m_type = TextInfo;
-            error = showText(args);
-        } else if (arg == "--color-selection") {
-            m_type = ColorSelection;
-            error = showColorSelection(args);
-        } else if (arg == "--font-selection") {
-            m_type = FontSelection;
-            error = showFontSelection(args);
-        } else if (arg == "--password") {
-            m_type = Password;
-            error = showPassword(args);
-        } else if (arg == "--forms") {
-            m_type = Forms;
-            error = showForms(args);
+        if (!arg.startsWith(QLatin1String("--")))
+            continue;
+        switch (optionHash(arg)) {
+            DIALOG_OPTION("--calendar", Calendar, showCalendar(args))
+            DIALOG_OPTION("--entry", Entry, showEntry(args))
+            DIALOG_OPTION("--error", Error, showMessage(args, 'e'))
+            DIALOG_OPTION("--info", Info, showMessage(args, 'i'))
+            DIALOG_OPTION("--file-selection", FileSelection, showFileSelection(args))
+            DIALOG_OPTION("--list", List, showList(args))
+            DIALOG_OPTION("--notification", Notification, showNotification(args))
+            DIALOG_OPTION("--progress", Progress, showProgress(args))
+            DIALOG_OPTION("--question", Question, showMessage(args, 'q'))
+            DIALOG_OPTION("--warning", Warning, showMessage(args, 'w'))
+            DIALOG_OPTION("--scale", Scale, showScale(args))
+            DIALOG_OPTION("--text-info", TextInfo, showText(args))
+            DIALOG_OPTION("--color-selection", ColorSelection, showColorSelection(args))
+            DIALOG_OPTION("--font-selection", FontSelection, showFontSelection(args))
+            DIALOG_OPTION("--password", Password, showPassword(args))
+            DIALOG_OPTION("--forms", Forms, showForms(args))
+            default: break;
         }
         if (error != 1) {
             break;
         }
     }
 
+    StartupTrace::mark("dialog");
     if (error) {
         QMetaObject::invokeMethod(this, "quit", Qt::QueuedConnection);
         return;
     }
 
     if (m_dialog) {
-#if QT_VERSION >= 0x050000
-        // this hacks access to the --title parameter in Qt5
-        // for some reason it's not set on the dialog.
-        // since it's set on showing the first QWindow, we just create one here and copy the title
-        // TODO: remove once this is fixed in Qt5
-        QWindow *w = new QWindow;
-        w->setVisible(true);
-        m_caption = w->title();
-        delete w;
-#endif
+        StartupTrace::watch(m_dialog);
         // close on ctrl+return in addition to ctrl+enter
         QAction *shortAccept = new QAction(m_dialog);
         m_dialog->addAction(shortAccept);
@@ -290,23 +438,12 @@ Qarma::Qarma(int &argc, char **argv) : QApplication(argc, argv)
             m_dialog->resize(sz);
         }
         m_dialog->setWindowModality(m_modal ? Qt::ApplicationModal : Qt::NonModal);
-        if (!m_caption.isNull()) {
-//            QMetaObject::invokeMethod(this, [=]() {m_dialog->setWindowTitle(m_caption);}, Qt::QueuedConnection);
-            /*
-            Fuck! This! Shit!
-            There's somehow a race condition and QWindow happily resets the window
-            title to the process name, because reasons.
-            Funny enough, m_dialog->windowHandle() is visible at this time, so
-            catching that signal does jack shit and inb4 some smartass wants to
-            point out that singleShot(0) is cumbersome and wrong and one should
-            invoke a QueuedConnection method: no, that doesn't work either
-            (likely because Qt queues its title nukation efforts down the road)
-            But hey, abstract and wayland and QML… FUCK! THIS! SHIT! *grrrrrrrr*
-            */
-            QTimer::singleShot(10, this, [=]() {m_dialog->setWindowTitle(m_caption);});
-        }
-        if (!m_icon.isNull())
+        if (!m_caption.isNull())
+            m_dialog->setWindowTitle(m_caption); // see protectTitle()
+        if (!m_icon.isNull()) {
             m_dialog->setWindowIcon(QIcon(m_icon));
+            StartupTrace::mark("window icon");
+        }
         QDialogButtonBox *box = m_dialog->findChild<QDialogButtonBox*>();
         if (box && !m_ok.isNull()) {
             if (QPushButton *btn = box->button(QDialogButtonBox::Ok))
@@ -360,10 +497,102 @@ static QString value(const QWidget *w, const QString &pattern)
     return QString();
 }
 
+// Results of List, FileSelection and Forms are written field by field as UTF-8 into the stdout
+// buffer instead of being joined and converted first. Records are separated by the separator
+// or, with --output-format, form a json array, are NUL terminated or are tsv lines.
+class OutputWriter
+{
+public:
+    enum Format { Separated, Json, Nul, Tsv };
+    OutputWriter(int format, const QString &separator, bool tuples = false)
+    : m_format(format), m_separator(separator.toUtf8()), m_tuples(tuples), m_records(0), m_fields(0) {
+        if (m_format == Json)
+            fputc('[', stdout);
+    }
+    void beginRecord() {
+        if (m_records)
+            write(m_format == Json ? QByteArray(",") : (m_format == Separated ? m_separator : QByteArray()));
+        if (m_format == Json && m_tuples)
+            fputc('[', stdout);
+    }
+    void field(const char *utf8, int size) {
+        if (m_fields++)
+            write(m_format == Json ? QByteArray(",") : (m_format == Tsv ? QByteArray("\t") : m_separator));
+        if (m_format == Json) {
+            fputc('"', stdout);
+            writeEscaped(utf8, size);
+            fputc('"', stdout);
+        } else if (m_format == Tsv) {
+            writeEscaped(utf8, size);
+        } else {
+            fwrite(utf8, 1, size, stdout);
+        }
+    }
+    void field(const QString &text) {
+        const QByteArray utf8 = text.toUtf8();
+        field(utf8.constData(), utf8.size());
+    }
+    void endRecord() {
+        if (m_format == Json && m_tuples)
+            fputc(']', stdout);
+        else if (m_format == Nul)
+            fputc('\0', stdout);
+        else if (m_format == Tsv)
+            fputc('\n', stdout);
+        ++m_records;
+        m_fields = 0;
+    }
+    // a record of one field
+    void record(const QString &text) {
+        beginRecord();
+        field(text);
+        endRecord();
+    }
+    void finish() {
+        if (m_format == Json)
+            fputs("]\n", stdout);
+        else if (m_format == Separated)
+            fputc('\n', stdout);
+        fflush(stdout);
+    }
+private:
+    void write(const QByteArray &ba) { fwrite(ba.constData(), 1, ba.size(), stdout); }
+    // json strings resp. tsv fields, multibyte sequences pass as they are
+    void writeEscaped(const char *utf8, int size) {
+        const char *run = utf8, *end = utf8 + size;
+        for (const char *c = utf8; c < end; ++c) {
+            const uchar u = *c;
+            const bool json = m_format == Json;
+            if (u >= 0x20 && u != '\\' && !(json && u == '"'))
+                continue;
+            fwrite(run, 1, c - run, stdout);
+            run = c + 1;
+            switch (u) {
+                case '\n': fputs("\\n", stdout); break;
+                case '\t': fputs("\\t", stdout); break;
+                case '\r': fputs("\\r", stdout); break;
+                case '\\': fputs("\\\\", stdout); break;
+                case '"': fputs("\\\"", stdout); break;
+                default:
+                    if (json)
+                        fprintf(stdout, "\\u%04x", u);
+                    else
+                        fputc(u, stdout);
+            }
+        }
+        fwrite(run, 1, end - run, stdout);
+    }
+    int m_format;
+    QByteArray m_separator;
+    bool m_tuples;
+    int m_records, m_fields;
+};
+
+static void printList(const QTreeView *tw, OutputWriter &out); // needs the ListModel
+
 void Qarma::dialogFinished(int status)
 {
-    if (m_type == FileSelection) {
-        QFileDialog *dlg = static_cast<QFileDialog*>(sender());
+    if (QFileDialog *dlg = qobject_cast<QFileDialog*>(sender())) {
         QVariantList l;
         for (int i = 0; i < dlg->sidebarUrls().count(); ++i)
             l << dlg->sidebarUrls().at(i);
@@ -375,7 +604,7 @@ void Qarma::dialogFinished(int status)
     if (!(status == QDialog::Accepted || status == QMessageBox::Ok || status == QMessageBox::Yes)) {
 #ifdef Q_OS_UNIX
         if (sender()->property("qarma_autokill_parent").toBool()) {
-            ::kill(getppid(), 15);
+            ::kill(gs_parentPid ? gs_parentPid : getppid(), 15);
         }
 #endif
         exit(1);
@@ -422,8 +651,12 @@ void Qarma::dialogFinished(int status)
             break;
         }
         case FileSelection: {
-            QStringList files = static_cast<QFileDialog*>(sender())->selectedFiles();
-            printf("%s\n", qPrintable(files.join(sender()->property("qarma_separator").toString())));
+            const QFileDialog *dlg = qobject_cast<QFileDialog*>(sender());
+            const QStringList files = dlg ? dlg->selectedFiles() : sender()->property("qarma_files").toStringList();
+            OutputWriter out(m_outputFormat, sender()->property("qarma_separator").toString());
+            foreach (const QString &file, files)
+                out.record(file);
+            out.finish();
             break;
         }
         case ColorSelection: {
@@ -473,34 +706,23 @@ void Qarma::dialogFinished(int status)
             break;
         }
         case List: {
-            QTreeWidget *tw = sender()->findChild<QTreeWidget*>();
-            QStringList result;
-            if (tw) {
-                bool done(false);
-                foreach (const QTreeWidgetItem *twi, tw->selectedItems()) {
-                    done = true;
-                    result << twi->text(0);
-                }
-                if (!done) { // checkable
-                    for (int i = 0; i < tw->topLevelItemCount(); ++i) {
-                        const QTreeWidgetItem *twi = tw->topLevelItem(i);
-                        if (twi->checkState(0) == Qt::Checked)
-                            result << twi->text(1);
-                    }
-                }
-            }
-            printf("%s\n", qPrintable(result.join(sender()->property("qarma_separator").toString())));
+            const QTreeView *tw = sender()->findChild<QTreeView*>();
+            const bool tuples = tw && tw->property("qarma_print_columns").toList().count() > 1;
+            OutputWriter out(m_outputFormat, sender()->property("qarma_separator").toString(), tuples);
+            if (tw)
+                printList(tw, out);
+            out.finish();
             break;
         }
         case Forms: {
             QFormLayout *fl = sender()->findChild<QFormLayout*>();
-            QStringList result;
+            OutputWriter out(m_outputFormat, sender()->property("qarma_separator").toString());
             QString format = sender()->property("qarma_date_format").toString();
             for (int i = 0; i < fl->count(); ++i) {
                 if (QLayoutItem *li = fl->itemAt(i, QFormLayout::FieldRole))
-                    result << value(li->widget(), format);
+                    out.record(value(li->widget(), format));
             }
-            printf("%s\n", qPrintable(result.join(sender()->property("qarma_separator").toString())));
+            out.finish();
             break;
         }
         default:
@@ -516,49 +738,86 @@ void Qarma::quitOnError()
 }
 
 #define NEXT_ARG QString((++i < args.count()) ? args.at(i) : QString())
+// options are matched through optionHash(), a handled one continues with the next argument
+#define OPTION(_OPT_) case optionHash(_OPT_): if (args.at(i) != QLatin1String(_OPT_)) break;
 #define WARN_UNKNOWN_ARG(_KNOWN_) if (args.at(i).startsWith("--") && args.at(i) != _KNOWN_) qDebug() << "unspecific argument" << args.at(i);
 #define SHOW_DIALOG m_dialog = dlg; connect(dlg, SIGNAL(finished(int)), SLOT(dialogFinished(int))); dlg->show();
 
+// --output-format: json, nul and tsv are 1..3, anything else 0
+static int outputFormat(const QString &name)
+{
+    static const QStringList formats = QStringList() << "json" << "nul" << "tsv";
+    return formats.indexOf(name) + 1;
+}
+
 bool Qarma::readGeneral(QStringList &args) {
     QStringList remains;
+    remains.reserve(args.count());
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--title") {
-            m_caption = NEXT_ARG;
-        } else if (args.at(i) == "--window-icon") {
-            m_icon = NEXT_ARG;
-        } else if (args.at(i) == "--width") {
-            bool ok;
-            const int w = NEXT_ARG.toUInt(&ok);
-            if (!ok)
-                return !error("--width must be followed by a positive number");
-            m_size.setWidth(w);
-        } else if (args.at(i) == "--height") {
-            bool ok;
-            const int h = NEXT_ARG.toUInt(&ok);
-            if (!ok)
-                return !error("--height must be followed by a positive number");
-            m_size.setHeight(h);
-        } else if (args.at(i) == "--timeout") {
-            bool ok;
-            const int t = NEXT_ARG.toUInt(&ok);
-            if (!ok)
-                return !error("--timeout must be followed by a positive number");
-            QTimer::singleShot(t*1000, this, SLOT(quit()));
-        } else if (args.at(i) == "--ok-label") {
-            m_ok = NEXT_ARG;
-        } else if (args.at(i) == "--cancel-label") {
-            m_cancel = NEXT_ARG;
-        } else if (args.at(i) == "--modal") {
-            m_modal = true;
-        } else if (args.at(i) == "--attach") {
-            bool ok;
-            const int w = NEXT_ARG.toUInt(&ok, 0);
-            if (!ok)
-                return !error("--attach must be followed by a positive number");
-            m_parentWindow = w;
-        } else {
-            remains << args.at(i);
+        if (args.at(i).startsWith(QLatin1String("--"))) {
+            switch (optionHash(args.at(i))) {
+            OPTION("--title") {
+                m_caption = NEXT_ARG;
+                continue;
+            }
+            OPTION("--window-icon") {
+                m_icon = NEXT_ARG;
+                continue;
+            }
+            OPTION("--width") {
+                bool ok;
+                const int w = NEXT_ARG.toUInt(&ok);
+                if (!ok)
+                    return !error("--width must be followed by a positive number");
+                m_size.setWidth(w);
+                continue;
+            }
+            OPTION("--height") {
+                bool ok;
+                const int h = NEXT_ARG.toUInt(&ok);
+                if (!ok)
+                    return !error("--height must be followed by a positive number");
+                m_size.setHeight(h);
+                continue;
+            }
+            OPTION("--timeout") {
+                bool ok;
+                const int t = NEXT_ARG.toUInt(&ok);
+                if (!ok)
+                    return !error("--timeout must be followed by a positive number");
+                QTimer::singleShot(t*1000, this, SLOT(quit()));
+                continue;
+            }
+            OPTION("--ok-label") {
+                m_ok = NEXT_ARG;
+                continue;
+            }
+            OPTION("--cancel-label") {
+                m_cancel = NEXT_ARG;
+                continue;
+            }
+            OPTION("--modal") {
+                m_modal = true;
+                continue;
+            }
+            OPTION("--output-format") {
+                m_outputFormat = outputFormat(NEXT_ARG);
+                if (!m_outputFormat)
+                    return !error("--output-format must be followed by json, nul or tsv");
+                continue;
+            }
+            OPTION("--attach") {
+                bool ok;
+                const int w = NEXT_ARG.toUInt(&ok, 0);
+                if (!ok)
+                    return !error("--attach must be followed by a positive number");
+                m_parentWindow = w;
+                continue;
+            }
+            default: break;
+            }
         }
+        remains << args.at(i);
     }
     args = remains;
     return true;
@@ -579,23 +838,36 @@ char Qarma::showCalendar(const QStringList &args)
     date.getDate(&y, &m, &d);
     bool ok;
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             vl->addWidget(new QLabel(NEXT_ARG, dlg));
-        } else if (args.at(i) == "--day") {
+            continue;
+        }
+        OPTION("--day") {
             d = NEXT_ARG.toUInt(&ok);
             if (!ok)
                 return !error("--day must be followed by a positive number");
-        } else if (args.at(i) == "--month") {
+            continue;
+        }
+        OPTION("--month") {
             m = NEXT_ARG.toUInt(&ok);
             if (!ok)
                 return !error("--month must be followed by a positive number");
-        } else if (args.at(i) == "--year") {
+            continue;
+        }
+        OPTION("--year") {
             y = NEXT_ARG.toUInt(&ok);
             if (!ok)
                 return !error("--year must be followed by a positive number");
-        } else if (args.at(i) == "--date-format") {
+            continue;
+        }
+        OPTION("--date-format") {
             dlg->setProperty("qarma_date_format", NEXT_ARG);
-        } else { WARN_UNKNOWN_ARG("--calendar") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--calendar")
     }
     date.setDate(y, m, d);
 
@@ -613,25 +885,39 @@ char Qarma::showEntry(const QStringList &args)
 {
     QInputDialog *dlg = new QInputDialog;
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text")
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             dlg->setLabelText(labelText(NEXT_ARG));
-        else if (args.at(i) == "--entry-text")
+            continue;
+        }
+        OPTION("--entry-text") {
             dlg->setTextValue(NEXT_ARG);
-        else if (args.at(i) == "--hide-text")
+            continue;
+        }
+        OPTION("--hide-text") {
             dlg->setTextEchoMode(QLineEdit::Password);
-        else if (args.at(i) == "--values") {
+            continue;
+        }
+        OPTION("--values") {
             dlg->setComboBoxItems(NEXT_ARG.split('|'));
             dlg->setComboBoxEditable(true);
-        } else if (args.at(i) == "--int") {
+            continue;
+        }
+        OPTION("--int") {
             dlg->setInputMode(QInputDialog::IntInput);
             dlg->setIntRange(INT_MIN, INT_MAX);
             dlg->setIntValue(NEXT_ARG.toInt());
-        } else if (args.at(i) == "--float") {
+            continue;
+        }
+        OPTION("--float") {
             dlg->setInputMode(QInputDialog::DoubleInput);
             dlg->setDoubleRange(DBL_MIN, DBL_MAX);
             dlg->setDoubleValue(NEXT_ARG.toDouble());
+            continue;
         }
-        else { WARN_UNKNOWN_ARG("--entry") }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--entry")
     }
     SHOW_DIALOG
 
@@ -645,14 +931,21 @@ char Qarma::showPassword(const QStringList &args)
     QLineEdit *username(NULL), *password(NULL);
     QString prompt = tr("Enter password");
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--username") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--username") {
             vl->addWidget(new QLabel(tr("Enter username"), dlg));
             vl->addWidget(username = new QLineEdit(dlg));
             username->setObjectName("qarma_username");
-            break;
-        } else if (args.at(i) == "--prompt") {
+            i = args.count(); // ends the options, as it always did
+            continue;
+        }
+        OPTION("--prompt") {
             prompt = NEXT_ARG;
-        } { WARN_UNKNOWN_ARG("--password") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--password")
     }
 
     vl->addWidget(new QLabel(prompt, dlg));
@@ -680,24 +973,46 @@ char Qarma::showMessage(const QStringList &args, char type)
 
     bool wrap = true, html = true;
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text")
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             dlg->setText(html ? labelText(NEXT_ARG) : NEXT_ARG);
-        else if (args.at(i) == "--icon-name")
+            continue;
+        }
+        OPTION("--icon-name") {
             dlg->setIconPixmap(QIcon(NEXT_ARG).pixmap(64));
-        else if (args.at(i) == "--no-wrap")
+            StartupTrace::mark("icon theme");
+            continue;
+        }
+        OPTION("--no-wrap") {
             wrap = false;
-        else if (args.at(i) == "--ellipsize")
+            continue;
+        }
+        OPTION("--ellipsize") {
             wrap = true;
-        else if (args.at(i) == "--no-markup")
+            continue;
+        }
+        OPTION("--no-markup") {
             html = false;
-        else if (args.at(i) == "--default-cancel")
+            continue;
+        }
+        OPTION("--default-cancel") {
             dlg->setDefaultButton(QMessageBox::Cancel);
-        else if (args.at(i) == "--selectable-labels")
+            continue;
+        }
+        OPTION("--selectable-labels") {
             m_selectableLabel = true;
-        else if (args.at(i).startsWith("--") && args.at(i) != "--info" && args.at(i) != "--question" &&
-                                                args.at(i) != "--warning" && args.at(i) != "--error")
+            continue;
+        }
+        OPTION("--info") continue;
+        OPTION("--question") continue;
+        OPTION("--warning") continue;
+        OPTION("--error") continue;
+        default: break;
+        }
+        if (args.at(i).startsWith("--"))
             qDebug() << "unspecific argument" << args.at(i);
     }
+
     if (QLabel *l = dlg->findChild<QLabel*>("qt_msgbox_label")) {
         l->setWordWrap(wrap);
         l->setTextFormat(html ? Qt::RichText : Qt::PlainText);
@@ -712,188 +1027,1449 @@ char Qarma::showMessage(const QStringList &args, char type)
     return 0;
 }
 
-char Qarma::showFileSelection(const QStringList &args)
+static QStringList splitSkipEmptyParts(const QString& str, const QRegularExpression& sep) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	return str.split(sep, Qt::SkipEmptyParts);
+#else
+	return str.split(sep, QString::SkipEmptyParts);
+#endif
+}
+
+static QStringList splitSkipEmptyParts(const QString& str, QChar sep) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	return str.split(sep, Qt::SkipEmptyParts);
+#else
+	return str.split(sep, QString::SkipEmptyParts);
+#endif
+}
+
+// --async-listing is qarma's own file picker. Directories are read on the thread pool, names
+// show up in batches as readdir() delivers them and the stat() results follow. The names
+// are cached per directory and reused as long as its mtime doesn't change, sizes and times
+// of the files can change without touching the directory, so they're always stat()ed anew.
+struct DirEntry
 {
-    QFileDialog *dlg = new QFileDialog;
-    QSettings settings("qarma");
-    dlg->setViewMode(settings.value("FileDetails", false).toBool() ? QFileDialog::Detail : QFileDialog::List);
-    dlg->setFileMode(QFileDialog::ExistingFile);
-    dlg->setOption(QFileDialog::DontConfirmOverwrite, false);
-    dlg->setProperty("qarma_separator", "|");
-    QVariantList l = settings.value("Bookmarks").toList();
-    QList<QUrl> bookmarks;
-    for (int i = 0; i < l.count(); ++i)
-        bookmarks << l.at(i).toUrl();
-    if (!bookmarks.isEmpty())
-        dlg->setSidebarUrls(bookmarks);
-    QStringList mimeFilters;
-    for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--filename") {
-            QString path = NEXT_ARG;
-            if (path.endsWith("/."))
-                dlg->setDirectory(path);
-            else
-                dlg->selectFile(path);
+    QString name;
+    bool dir;
+    qint64 size, mtime; // -1 until stat()ed
+};
+
+static bool entryLessThan(const DirEntry &a, const DirEntry &b)
+{
+    if (a.dir != b.dir)
+        return a.dir;
+    return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
+}
+
+enum { ListingCacheVersion = 2, ListingCacheMaxEntries = 1 << 22 };
+
+static QString listingCachePath(const QString &path, const QStringList &nameFilters, bool dirsOnly)
+{
+    static const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/qarma/listings";
+    const QByteArray key = QFile::encodeName(path) + '\0' + nameFilters.join(' ').toUtf8() + (dirsOnly ? "\0d" : "\0f");
+    return cacheDir + '/' + QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex();
+}
+
+class DirectoryModel;
+
+class DirectoryJob : public QRunnable
+{
+public:
+    DirectoryJob(DirectoryModel *model, const QString &path, const QStringList &nameFilters, bool dirsOnly,
+                 const QSharedPointer<QAtomicInt> &generation);
+    // only stat() the entries of a cached listing
+    DirectoryJob(DirectoryModel *model, const QString &path, const QVector<DirEntry> &entries,
+                 const QSharedPointer<QAtomicInt> &generation);
+    void run() override;
+private:
+    bool canceled() const { return m_generation->loadAcquire() != m_myGeneration; }
+    void post(const QVector<DirEntry> &entries, int statsFrom, bool done);
+    QPointer<DirectoryModel> m_model;
+    QString m_path;
+    QStringList m_nameFilters;
+    bool m_dirsOnly, m_listed;
+    QVector<DirEntry> m_entries;
+    QSharedPointer<QAtomicInt> m_generation;
+    int m_myGeneration;
+};
+
+class DirectoryModel : public QAbstractTableModel
+{
+public:
+    DirectoryModel(QObject *parent) : QAbstractTableModel(parent), m_generation(new QAtomicInt(0)) {}
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : m_entries.count();
+    }
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : 3;
+    }
+    QString filePath(int row) const { return QDir(m_path).absoluteFilePath(m_entries.at(row).name); }
+    bool isDir(int row) const { return m_entries.at(row).dir; }
+    bool isCurrent(int generation) const { return m_generation->loadAcquire() == generation; }
+    void load(const QString &path, const QStringList &nameFilters, bool dirsOnly) {
+        m_generation->fetchAndAddOrdered(1);
+        beginResetModel();
+        m_path = path;
+        m_entries.clear();
+        endResetModel();
+
+        QFile cache(listingCachePath(path, nameFilters, dirsOnly));
+        if (cache.open(QIODevice::ReadOnly)) {
+            QDataStream stream(&cache);
+            quint32 version, count;
+            qint64 mtime;
+            stream >> version >> mtime >> count;
+            if (stream.status() == QDataStream::Ok && version == ListingCacheVersion && count <= ListingCacheMaxEntries &&
+                mtime == QFileInfo(path).lastModified().toMSecsSinceEpoch()) {
+                QVector<DirEntry> entries;
+                entries.reserve(qMin<quint32>(count, 65536)); // don't trust it with the memory
+                for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                    DirEntry entry;
+                    stream >> entry.name >> entry.dir;
+                    entry.size = entry.mtime = -1;
+                    entries << entry;
+                }
+                if (stream.status() == QDataStream::Ok && stream.atEnd()) {
+                    append(entries);
+                    finish();
+                    QThreadPool::globalInstance()->start(new DirectoryJob(this, path, m_entries, m_generation));
+                    return;
+                }
+            }
         }
-        else if (args.at(i) == "--multiple")
-            dlg->setFileMode(QFileDialog::ExistingFiles);
-        else if (args.at(i) == "--directory") {
-            dlg->setFileMode(QFileDialog::Directory);
-            dlg->setOption(QFileDialog::ShowDirsOnly);
-        } else if (args.at(i) == "--save") {
-            dlg->setFileMode(QFileDialog::AnyFile);
-            dlg->setAcceptMode(QFileDialog::AcceptSave);
+        QThreadPool::globalInstance()->start(new DirectoryJob(this, path, nameFilters, dirsOnly, m_generation));
+    }
+    void append(const QVector<DirEntry> &entries) {
+        if (entries.isEmpty())
+            return;
+        beginInsertRows(QModelIndex(), m_entries.count(), m_entries.count() + entries.count() - 1);
+        m_entries += entries;
+        endInsertRows();
+    }
+    void setStats(int first, const QVector<DirEntry> &entries) {
+        if (entries.isEmpty())
+            return;
+        for (int i = 0; i < entries.count(); ++i) {
+            m_entries[first + i].size = entries.at(i).size;
+            m_entries[first + i].mtime = entries.at(i).mtime;
         }
-        else if (args.at(i) == "--separator")
-            dlg->setProperty("qarma_separator", NEXT_ARG);
-        else if (args.at(i) == "--confirm-overwrite")
-            dlg->setOption(QFileDialog::DontConfirmOverwrite);
-        else if (args.at(i) == "--file-filter") {
-            QString mimeFilter = NEXT_ARG;
-            const int idx = mimeFilter.indexOf('|');
-            if (idx > -1)
-                mimeFilter = mimeFilter.left(idx).trimmed() + " (" + mimeFilter.mid(idx+1).trimmed() + ")";
-            mimeFilters << mimeFilter;
+        emit dataChanged(index(first, 1), index(first + entries.count() - 1, 2));
+    }
+    // the listing is complete, sort it - the selection sticks to its entries
+    void finish() {
+        emit layoutAboutToBeChanged();
+        QVector<int> order(m_entries.count());
+        for (int i = 0; i < order.count(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+            return entryLessThan(m_entries.at(a), m_entries.at(b));
+        });
+        QVector<int> newRow(order.count());
+        QVector<DirEntry> sorted;
+        sorted.reserve(order.count());
+        for (int i = 0; i < order.count(); ++i) {
+            newRow[order.at(i)] = i;
+            sorted << m_entries.at(order.at(i));
         }
-        else { WARN_UNKNOWN_ARG("--file-selection") }
+        m_entries = sorted;
+        const QModelIndexList from = persistentIndexList();
+        QModelIndexList to;
+        foreach (const QModelIndex &idx, from)
+            to << index(newRow.at(idx.row()), idx.column());
+        changePersistentIndexList(from, to);
+        emit layoutChanged();
     }
-    dlg->setNameFilters(mimeFilters);
-    SHOW_DIALOG
-    return 0;
-}
+    QVariant data(const QModelIndex &idx, int role) const override {
+        if (!idx.isValid())
+            return QVariant();
+        const DirEntry &entry = m_entries.at(idx.row());
+        if (role == Qt::DisplayRole) {
+            if (idx.column() == 0)
+                return entry.name;
+            if (idx.column() == 1)
+                return (entry.dir || entry.size < 0) ? QString() : QLocale::system().formattedDataSize(entry.size);
+            return entry.mtime < 0 ? QString() : QLocale::system().toString(QDateTime::fromMSecsSinceEpoch(entry.mtime), QLocale::ShortFormat);
+        }
+        if (role == Qt::DecorationRole && idx.column() == 0) {
+            static QFileIconProvider provider;
+            return provider.icon(entry.dir ? QFileIconProvider::Folder : QFileIconProvider::File);
+        }
+        return QVariant();
+    }
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+            return QAbstractTableModel::headerData(section, orientation, role);
+        return section == 0 ? Qarma::tr("Name") : (section == 1 ? Qarma::tr("Size") : Qarma::tr("Modified"));
+    }
+private:
+    QString m_path;
+    QVector<DirEntry> m_entries;
+    QSharedPointer<QAtomicInt> m_generation;
+};
 
-void Qarma::toggleItems(QTreeWidgetItem *item, int column)
+DirectoryJob::DirectoryJob(DirectoryModel *model, const QString &path, const QStringList &nameFilters, bool dirsOnly,
+                           const QSharedPointer<QAtomicInt> &generation)
+: m_model(model), m_path(path), m_nameFilters(nameFilters), m_dirsOnly(dirsOnly), m_listed(false)
+, m_generation(generation), m_myGeneration(generation->loadAcquire())
 {
-    if (column)
-        return; // not the checkmark
+}
 
-    static bool recursion = false;
-    if (recursion)
-        return;
+DirectoryJob::DirectoryJob(DirectoryModel *model, const QString &path, const QVector<DirEntry> &entries,
+                           const QSharedPointer<QAtomicInt> &generation)
+: m_model(model), m_path(path), m_dirsOnly(false), m_listed(true), m_entries(entries)
+, m_generation(generation), m_myGeneration(generation->loadAcquire())
+{
+}
 
-    recursion = true;
-    QTreeWidget *tw = item->treeWidget();
-    for (int i = 0; i < tw->topLevelItemCount(); ++i) {
-        QTreeWidgetItem *twi = tw->topLevelItem(i);
-        if (twi != item)
-            twi->setCheckState(0, Qt::Unchecked);
-    }
-    recursion = false;
+void DirectoryJob::post(const QVector<DirEntry> &entries, int statsFrom, bool done)
+{
+    QPointer<DirectoryModel> model = m_model;
+    const int generation = m_myGeneration;
+    QMetaObject::invokeMethod(qApp, [=]() {
+        if (!model || !model->isCurrent(generation))
+            return;
+        if (statsFrom < 0)
+            model->append(entries);
+        else
+            model->setStats(statsFrom, entries);
+        if (done)
+            model->finish();
+    }, Qt::QueuedConnection);
 }
 
-static void addItems(QTreeWidget *tw, QStringList &values, bool editable, bool checkable, bool icons)
+void DirectoryJob::run()
 {
-    for (int i = 0; i < values.count(); ) {
-        QStringList itemValues;
-        for (int j = 0; j < tw->columnCount(); ++j) {
-            itemValues << values.at(i++);
-            if (i == values.count())
-                break;
-        }
-        QTreeWidgetItem *item = new QTreeWidgetItem(tw, itemValues);
-        Qt::ItemFlags flags = item->flags();
-        if (editable)
-            flags |= Qt::ItemIsEditable;
-        if (checkable) {
-            flags |= Qt::ItemIsUserCheckable;
-            item->setCheckState(0, Qt::Unchecked);
+    const qint64 dirMtime = QFileInfo(m_path).lastModified().toMSecsSinceEpoch();
+
+    // names first, the file type usually comes for free with the directory entry
+    QVector<DirEntry> entries = m_entries, batch;
+    QElapsedTimer timer;
+    timer.start();
+    if (!m_listed) {
+        QDir::Filters filters = QDir::AllDirs | QDir::NoDotAndDotDot;
+        if (!m_dirsOnly)
+            filters |= QDir::Files | QDir::System;
+        QDirIterator it(m_path, m_nameFilters, filters);
+        while (it.hasNext()) {
+            it.next();
+            if (!(entries.count() % 256) && canceled())
+                return;
+            DirEntry entry;
+            entry.name = it.fileName();
+            entry.dir = it.fileInfo().isDir();
+            entry.size = entry.mtime = -1;
+            entries << entry;
+            batch << entry;
+            if (batch.count() > 1023 || timer.elapsed() > 50) {
+                post(batch, -1, false);
+                batch.clear();
+                timer.restart();
+            }
         }
-        if (icons)
-            item->setIcon(0, QPixmap(item->text(0)));
-        if (checkable || icons) {
-            item->setData(0, Qt::EditRole, item->text(0));
-            item->setText(0, QString());
+        post(batch, -1, false);
+    }
+
+    // then stat() them
+    const QDir dir(m_path);
+    batch.clear();
+    int first = 0;
+    for (int i = 0; i < entries.count(); ++i) {
+        if (!(i % 256) && canceled())
+            return;
+        const QFileInfo info(dir.filePath(entries.at(i).name));
+        entries[i].size = info.size();
+        entries[i].mtime = info.lastModified().toMSecsSinceEpoch();
+        batch << entries.at(i);
+        if (batch.count() > 1023 || timer.elapsed() > 50) {
+            post(batch, first, false);
+            first = i + 1;
+            batch.clear();
+            timer.restart();
         }
-        item->setFlags(flags);
-        tw->addTopLevelItem(item);
+    }
+    post(batch, first, true);
+    if (m_listed)
+        return;
+
+    QSaveFile cache(listingCachePath(m_path, m_nameFilters, m_dirsOnly));
+    if (QDir().mkpath(QFileInfo(cache.fileName()).path()) && cache.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&cache);
+        stream << quint32(ListingCacheVersion) << dirMtime << quint32(entries.count());
+        foreach (const DirEntry &entry, entries)
+            stream << entry.name << entry.dir;
+        cache.commit();
     }
 }
 
-char Qarma::showList(const QStringList &args)
+char Qarma::showFilePicker(const QStringList &args)
 {
     NEW_DIALOG
+    dlg->setProperty("qarma_separator", "|");
 
-    QLabel *lbl;
-    vl->addWidget(lbl = new QLabel(dlg));
+    QHBoxLayout *hl = new QHBoxLayout;
+    vl->addLayout(hl);
+    QPushButton *up;
+    QLineEdit *location, *filename;
+    QTreeView *view;
+    QComboBox *filterBox;
+    hl->addWidget(up = new QPushButton(QIcon::fromTheme("go-up"), QString(), dlg));
+    hl->addWidget(location = new QLineEdit(dlg));
+    vl->addWidget(view = new QTreeView(dlg));
+    vl->addWidget(filename = new QLineEdit(dlg));
+    vl->addWidget(filterBox = new QComboBox(dlg));
+    view->setRootIsDecorated(false);
+    view->setUniformRowHeights(true);
+    view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    view->setSelectionMode(QAbstractItemView::SingleSelection);
+    view->setAllColumnsShowFocus(true);
 
-    QTreeWidget *tw;
-    vl->addWidget(tw = new QTreeWidget(dlg));
-    tw->setSelectionBehavior(QAbstractItemView::SelectRows);
-    tw->setSelectionMode(QAbstractItemView::SingleSelection);
-    tw->setRootIsDecorated(false);
-    tw->setAllColumnsShowFocus(true);
+    bool dirsOnly(false), save(false), confirm(false);
+    QString startDir = QDir::currentPath(), startFile;
+    for (int i = 0; i < args.count(); ++i) {
+        switch (optionHash(args.at(i))) {
+        OPTION("--filename") {
+            QString path = NEXT_ARG;
+            const QFileInfo info(path);
+            if (path.endsWith("/.") || info.isDir()) {
+                startDir = info.absoluteFilePath();
+            } else {
+                startDir = info.absolutePath();
+                startFile = info.fileName();
+            }
+            continue;
+        }
+        OPTION("--multiple") {
+            view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+            continue;
+        }
+        OPTION("--directory") {
+            dirsOnly = true;
+            continue;
+        }
+        OPTION("--save") {
+            save = true;
+            continue;
+        }
+        OPTION("--separator") {
+            dlg->setProperty("qarma_separator", NEXT_ARG);
+            continue;
+        }
+        OPTION("--confirm-overwrite") {
+            confirm = true;
+            continue;
+        }
+        OPTION("--file-filter") {
+            QString mimeFilter = NEXT_ARG;
+            const int idx = mimeFilter.indexOf('|');
+            if (idx > -1)
+                mimeFilter = mimeFilter.left(idx).trimmed() + " (" + mimeFilter.mid(idx+1).trimmed() + ")";
+            filterBox->addItem(mimeFilter);
+            continue;
+        }
+        OPTION("--async-listing") continue;
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--file-selection")
+    }
+    filename->setVisible(save);
+    filename->setText(startFile);
+    filterBox->setVisible(filterBox->count());
+
+    DirectoryModel *model = new DirectoryModel(view);
+    view->setModel(model);
+
+    auto open = [=](const QString &path) {
+        location->setText(QDir::cleanPath(path));
+        QStringList nameFilters;
+        const QString filter = filterBox->currentText();
+        const int from = filter.lastIndexOf('('), to = filter.lastIndexOf(')');
+        if (from > -1 && to > from)
+            nameFilters = splitSkipEmptyParts(filter.mid(from + 1, to - from - 1), ' ');
+        else if (!filter.isEmpty())
+            nameFilters = splitSkipEmptyParts(filter, ' ');
+        model->load(location->text(), nameFilters, dirsOnly);
+    };
+    auto accept = [=]() {
+        QStringList files;
+        if (save) {
+            if (filename->text().isEmpty())
+                return;
+            const QString file = QDir(location->text()).absoluteFilePath(filename->text());
+            if (confirm && QFileInfo::exists(file) &&
+                QMessageBox::question(dlg, tr("Overwrite?"), tr("%1 already exists. Do you want to replace it?").arg(file)) != QMessageBox::Yes)
+                return;
+            files << file;
+        } else {
+            foreach (const QModelIndex &idx, view->selectionModel()->selectedRows()) {
+                if (dirsOnly || !model->isDir(idx.row()))
+                    files << model->filePath(idx.row());
+            }
+            if (files.isEmpty() && dirsOnly)
+                files << location->text();
+            if (files.isEmpty())
+                return;
+        }
+        dlg->setProperty("qarma_files", files);
+        dlg->accept();
+    };
+
+    connect(up, &QPushButton::clicked, dlg, [=]() {
+        QDir dir(location->text());
+        if (dir.cdUp())
+            open(dir.absolutePath());
+    });
+    connect(location, &QLineEdit::returnPressed, dlg, [=]() { open(location->text()); });
+    connect(filterBox, QOverload<int>::of(&QComboBox::currentIndexChanged), dlg, [=]() { open(location->text()); });
+    connect(view, &QTreeView::activated, dlg, [=](const QModelIndex &idx) {
+        if (model->isDir(idx.row()))
+            open(model->filePath(idx.row()));
+        else
+            accept();
+    });
+    if (save) {
+        connect(view->selectionModel(), &QItemSelectionModel::currentRowChanged, dlg, [=](const QModelIndex &idx) {
+            if (idx.isValid() && !model->isDir(idx.row()))
+                filename->setText(QFileInfo(model->filePath(idx.row())).fileName());
+        });
+    }
+
+    QDialogButtonBox *btns = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel, Qt::Horizontal, dlg);
+    vl->addWidget(btns);
+    connect(btns, &QDialogButtonBox::accepted, dlg, accept);
+    connect(btns, SIGNAL(rejected()), dlg, SLOT(reject()));
+
+    open(startDir);
+    SHOW_DIALOG
+    return 0;
+}
+
+char Qarma::showFileSelection(const QStringList &args)
+{
+    if (args.contains("--async-listing"))
+        return showFilePicker(args);
+
+    QFileDialog *dlg = new QFileDialog;
+    QSettings settings("qarma");
+    dlg->setViewMode(settings.value("FileDetails", false).toBool() ? QFileDialog::Detail : QFileDialog::List);
+    dlg->setFileMode(QFileDialog::ExistingFile);
+    dlg->setOption(QFileDialog::DontConfirmOverwrite, false);
+    dlg->setProperty("qarma_separator", "|");
+    QVariantList l = settings.value("Bookmarks").toList();
+    QList<QUrl> bookmarks;
+    for (int i = 0; i < l.count(); ++i)
+        bookmarks << l.at(i).toUrl();
+    if (!bookmarks.isEmpty())
+        dlg->setSidebarUrls(bookmarks);
+    StartupTrace::mark("settings");
+    QStringList mimeFilters;
+    for (int i = 0; i < args.count(); ++i) {
+        switch (optionHash(args.at(i))) {
+        OPTION("--filename") {
+            QString path = NEXT_ARG;
+            if (path.endsWith("/."))
+                dlg->setDirectory(path);
+            else
+                dlg->selectFile(path);
+            continue;
+        }
+        OPTION("--multiple") {
+            dlg->setFileMode(QFileDialog::ExistingFiles);
+            continue;
+        }
+        OPTION("--directory") {
+            dlg->setFileMode(QFileDialog::Directory);
+            dlg->setOption(QFileDialog::ShowDirsOnly);
+            continue;
+        }
+        OPTION("--save") {
+            dlg->setFileMode(QFileDialog::AnyFile);
+            dlg->setAcceptMode(QFileDialog::AcceptSave);
+            continue;
+        }
+        OPTION("--separator") {
+            dlg->setProperty("qarma_separator", NEXT_ARG);
+            continue;
+        }
+        OPTION("--confirm-overwrite") {
+            dlg->setOption(QFileDialog::DontConfirmOverwrite);
+            continue;
+        }
+        OPTION("--file-filter") {
+            QString mimeFilter = NEXT_ARG;
+            const int idx = mimeFilter.indexOf('|');
+            if (idx > -1)
+                mimeFilter = mimeFilter.left(idx).trimmed() + " (" + mimeFilter.mid(idx+1).trimmed() + ")";
+            mimeFilters << mimeFilter;
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--file-selection")
+    }
+
+    dlg->setNameFilters(mimeFilters);
+    SHOW_DIALOG
+    return 0;
+}
+
+// The cells of a --list, rows are consecutive cells. QTreeWidgetItem costs a few hundred bytes
+// per row, so they live in one UTF-8 pool and are addressed by (offset, length) pairs.
+// Copies are implicitly shared and serve as snapshots for the worker threads.
+struct ListCells
+{
+    ListCells(int columns = 1) : columns(qMax(columns, 1)) {}
+    int count() const { return (offset.count() + columns - 1) / columns; }
+    QString text(int row, int column) const {
+        const int cell = row*columns + column;
+        if (cell >= offset.count())
+            return QString();
+        return QString::fromUtf8(pool.constData() + offset.at(cell), length.at(cell));
+    }
+    // the UTF-8 of a cell, without a copy
+    const char *utf8(int row, int column, int *size) const {
+        const int cell = row*columns + column;
+        *size = cell < offset.count() ? length.at(cell) : 0;
+        return cell < offset.count() ? pool.constData() + offset.at(cell) : "";
+    }
+    void append(const QByteArray &cell) {
+        offset << pool.size();
+        length << cell.size();
+        pool += cell;
+    }
+    int columns;
+    QByteArray pool;
+    QVector<int> offset, length;
+};
+
+// Column widths estimated from a bounded sample instead of measuring every cell: the first
+// rows, the last rows of each batch and any text longer than the longest one measured so far.
+struct TextWidths
+{
+    enum { SampleRows = 32 };
+    void add(const QStringList &cells, int firstCell, int columns, const QFontMetrics &fm, bool skipFirstColumn) {
+        if (width.count() < columns) {
+            width.resize(columns);
+            longest.resize(columns);
+        }
+        const int tail = cells.count() - SampleRows*columns;
+        for (int i = 0; i < cells.count(); ++i) {
+            const int cell = firstCell + i, column = cell % columns;
+            const QString &text = cells.at(i);
+            if ((column || !skipFirstColumn) &&
+                (cell / columns < SampleRows || i >= tail || text.length() > longest.at(column))) {
+                longest[column] = qMax(longest.at(column), text.length());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+                width[column] = qMax(width.at(column), fm.horizontalAdvance(text));
+#else
+                width[column] = qMax(width.at(column), fm.width(text));
+#endif
+            }
+        }
+    }
+    QVector<int> width, longest;
+};
+
+// widens the columns to the estimate, like resizeColumnToContents() does it for the measured text
+static void fitColumns(QTreeView *tw, const TextWidths &widths, int columns, int decoration)
+{
+    const int margin = 2 * (tw->style()->pixelMetric(QStyle::PM_FocusFrameHMargin, 0, tw) + 1);
+    for (int i = 0; i < columns; ++i) {
+        int w = (i < widths.width.count() ? widths.width.at(i) : 0) + margin + (i ? 0 : decoration);
+        if (!tw->isHeaderHidden())
+            w = qMax(w, tw->header()->sectionSizeHint(i));
+        if (w > tw->columnWidth(i))
+            tw->setColumnWidth(i, w);
+    }
+}
+
+// Casefolded text of all cells for --mid-search. Cells end with \x1f and rows with \n, so
+// a match can't span either. It's built on first use and extended as rows get added, an
+// incomplete last row is indexed again once more of its cells are in.
+struct SearchIndex
+{
+    SearchIndex() : cells(0) { rowStart << 0; }
+    int rows() const { return rowStart.count() - 1; }
+    QString text;
+    QVector<int> rowStart; // plus the end of the last row
+    int cells; // indexed so far
+};
+typedef QSharedPointer<const SearchIndex> SearchIndexPtr;
+
+// Sort keys of one column. Like the search index they're kept between sorts and only get
+// extended by the rows added since, so a new batch is merged into the existing order.
+struct SortKeys
+{
+    SortKeys(int column, int type) : column(column), type(type), cells(0) {}
+    int rows() const { return text.empty() ? number.count() : int(text.size()); }
+    void removeLast() {
+        if (!text.empty())
+            text.pop_back();
+        if (!number.isEmpty())
+            number.removeLast();
+    }
+    int column, type;
+    std::vector<QCollatorSortKey> text; // ListModel::Text
+    QVector<double> number; // the other types
+    QBitArray valid; // of the numbers, invalid ones go last
+    int cells; // covered so far
+};
+typedef QSharedPointer<const SortKeys> SortKeysPtr;
+
+class ListModel;
+
+// Decodes an --imagelist icon on the thread pool, scaled down to the icon size and going
+// through a disk cache keyed by path and mtime. Rows that were scrolled out of view while
+// the job was queued clear "wanted" and are skipped.
+class ThumbnailJob : public QRunnable
+{
+public:
+    ThumbnailJob(ListModel *model, int row, const QString &path, const QSize &size, const QSharedPointer<QAtomicInt> &wanted);
+    void run() override;
+private:
+    QPointer<ListModel> m_model;
+    int m_row;
+    QString m_path;
+    QSize m_size;
+    QSharedPointer<QAtomicInt> m_wanted;
+};
+
+// Runs a --mid-search query on the thread pool. A newer query bumps the generation, which
+// makes older jobs bail out early and drops their results.
+class ListFilter : public QRunnable
+{
+public:
+    ListFilter(ListModel *model, const ListCells &cells, const SearchIndexPtr &index, const QString &query,
+               const QString &previousQuery, const QVector<int> &previousRows, int previousCovered,
+               const QVector<int> &rank, const QSharedPointer<QAtomicInt> &generation);
+    void run() override;
+private:
+    bool canceled() const { return m_generation->loadAcquire() != m_myGeneration; }
+    QPointer<ListModel> m_model;
+    ListCells m_cells;
+    SearchIndexPtr m_index;
+    QString m_query, m_previousQuery;
+    QVector<int> m_previousRows, m_rank;
+    int m_previousCovered;
+    QSharedPointer<QAtomicInt> m_generation;
+    int m_myGeneration;
+};
+
+// The position of a source row in the sorted order, rows added after the sort follow in source order
+static inline int rankOf(const QVector<int> &rank, int row)
+{
+    return row < rank.count() ? rank.at(row) : row;
+}
+
+// Sorts a snapshot of the --list rows on the thread pool. The keys are computed once per row
+// according to the column type, the result is the new order of the source rows. Given the
+// order of a previous run with the same keys, only the rows added since get sorted and merged.
+class ListSorter : public QRunnable
+{
+public:
+    ListSorter(ListModel *model, const ListCells &cells, int column, int type, Qt::SortOrder order,
+               const SortKeysPtr &keys, const QVector<int> &previous, const QSharedPointer<QAtomicInt> &generation);
+    void run() override;
+private:
+    bool canceled() const { return m_generation->loadAcquire() != m_myGeneration; }
+    QPointer<ListModel> m_model;
+    ListCells m_cells;
+    int m_column, m_type;
+    Qt::SortOrder m_order;
+    SortKeysPtr m_keys;
+    QVector<int> m_previous;
+    QSharedPointer<QAtomicInt> m_generation;
+    int m_myGeneration;
+};
+
+// Backing store for --list. The view sees either all rows or, when filtered and/or sorted, the
+// source rows in m_rows - everything that isn't about presentation addresses source rows.
+class ListModel : public QAbstractTableModel
+{
+public:
+    enum Flag { Editable = 1, Checkable = 1<<1, Icons = 1<<2, Exclusive = 1<<3 };
+    enum ColumnType { Text, Numeric, Date, Size }; // --column=NAME:TYPE
+    ListModel(int columns, int flags, QObject *parent) : QAbstractTableModel(parent)
+    , m_cells(columns), m_flags(flags), m_checkedRow(-1), m_mapped(false), m_filtered(false), m_filterRunning(false), m_filterCovered(0)
+    , m_generation(new QAtomicInt(0)), m_sortColumn(-1), m_sortOrder(Qt::AscendingOrder), m_sortedOrder(Qt::AscendingOrder), m_sortRunning(false), m_sorted(false)
+    , m_sortGeneration(new QAtomicInt(0)) {}
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : (m_mapped ? m_rows.count() : m_cells.count());
+    }
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : m_cells.columns;
+    }
+    int count() const { return m_cells.count(); }
+    int sourceRow(int row) const { return m_mapped ? m_rows.at(row) : row; }
+    QString text(int row, int column) const { return m_cells.text(row, column); }
+    const ListCells &cells() const { return m_cells; }
+    // checkmarks and images replace the text of the first column
+    bool showsText(int column) const { return column || !(m_flags & (Checkable|Icons)); }
+    bool isChecked(int row) const { return m_checked.testBit(row); }
+    void setHeaders(const QStringList &headers) { m_headers = headers; }
+    void setFont(const QFont &font) { m_font = font; }
+    const TextWidths &textWidths() const { return m_widths; }
+    void setColumnTypes(const QVector<int> &types) { m_types = types; }
+    void setIconSize(const QSize &size) { m_iconSize = size; }
+    void setThumbnail(int row, const QImage &image) {
+        m_thumbnailJobs.remove(row);
+        m_icons.insert(row, QPixmap::fromImage(image));
+        const int view = viewRow(row);
+        if (view > -1)
+            emit dataChanged(index(view, 0), index(view, 0), QVector<int>() << Qt::DecorationRole);
+    }
+    // the job skipped the row, it's asked for again once it's painted - or now, if it's back in view
+    void thumbnailSkipped(int row) {
+        const QSharedPointer<QAtomicInt> wanted = m_thumbnailJobs.take(row);
+        if (wanted && wanted->loadAcquire())
+            requestThumbnail(row);
+        else
+            m_icons.remove(row);
+    }
+    // queued thumbnails of rows outside the view rows first..last get skipped
+    void keepThumbnails(int first, int last) {
+        for (auto it = m_thumbnailJobs.begin(); it != m_thumbnailJobs.end(); ++it) {
+            const int view = viewRow(it.key());
+            it.value()->storeRelease(view >= first && view <= last);
+        }
+    }
+    void addCells(const QStringList &cells) {
+        if (cells.isEmpty())
+            return;
+        m_widths.add(cells, m_cells.offset.count(), m_cells.columns, QFontMetrics(m_font), m_flags & (Checkable|Icons));
+        const int oldRows = m_cells.count();
+        const int partial = m_cells.offset.count() % m_cells.columns;
+        const int newRows = (m_cells.offset.count() + cells.count() + m_cells.columns - 1) / m_cells.columns;
+        if (m_sorted) { // new rows go last until the next sort is in
+            for (int row = oldRows; row < newRows; ++row)
+                m_order << row;
+        }
+        if (m_filtered) { // the filter decides whether they show up
+            foreach (const QString &cell, cells)
+                m_cells.append(cell.toUtf8());
+            m_checked.resize(newRows);
+            const int view = partial ? viewRow(oldRows - 1) : -1;
+            if (view > -1) // a shown row got completed
+                emit dataChanged(index(view, partial), index(view, m_cells.columns - 1));
+            if (m_sortColumn > -1 && !m_sortRunning) // otherwise the running one picks them up
+                startSort();
+            if (!m_filterRunning)
+                setFilter(m_query);
+            return;
+        }
+        if (newRows > oldRows)
+            beginInsertRows(QModelIndex(), oldRows, newRows - 1);
+        m_cells.offset.reserve(m_cells.offset.count() + cells.count());
+        m_cells.length.reserve(m_cells.length.count() + cells.count());
+        foreach (const QString &cell, cells)
+            m_cells.append(cell.toUtf8());
+        m_checked.resize(newRows);
+        if (m_mapped)
+            m_rows = m_order;
+        if (newRows > oldRows)
+            endInsertRows();
+        if (partial) { // the last row of the previous batch got completed
+            const int view = viewRow(oldRows - 1);
+            emit dataChanged(index(view, partial), index(view, m_cells.columns - 1));
+        }
+        if (m_sortColumn > -1 && !m_sortRunning) // otherwise the running one picks them up
+            startSort();
+    }
+    void setFilter(const QString &query) {
+        m_query = query.toCaseFolded();
+        m_generation->fetchAndAddOrdered(1);
+        m_filterRunning = !m_query.isEmpty();
+        if (m_query.isEmpty()) {
+            m_filterQuery.clear();
+            m_filterRows.clear();
+            m_filterCovered = 0;
+            m_filtered = false;
+            setRows(m_order, m_sorted, m_rank);
+            return;
+        }
+        QThreadPool::globalInstance()->start(new ListFilter(this, m_cells, m_index, m_query, m_filterQuery,
+                                                            m_filterRows, m_filterCovered, m_rank, m_generation));
+    }
+    void applyFilter(const QString &query, const QVector<int> &rows, const QVector<int> &rank, const SearchIndexPtr &index) {
+        m_index = index;
+        m_filterQuery = query;
+        m_filterRows = rows;
+        m_filterCovered = index->cells / m_cells.columns; // complete rows
+        m_filterRunning = false;
+        m_filtered = true;
+        setRows(rows, true, rank);
+        if (index->cells < m_cells.offset.count() || rank != m_rank) // cells were added or sorted in the meantime
+            setFilter(m_query);
+    }
+    bool isCurrent(int generation) const { return m_generation->loadAcquire() == generation; }
+    // clicking a header sorts by that column, the header's "no column" restores the source order
+    void sort(int column, Qt::SortOrder order) override {
+        m_sortColumn = column < m_cells.columns ? column : -1;
+        m_sortOrder = order;
+        if (m_sortColumn > -1) {
+            startSort();
+            return;
+        }
+        m_sortGeneration->fetchAndAddOrdered(1);
+        m_sortRunning = m_sorted = false;
+        m_sortKeys.clear();
+        m_order.clear();
+        m_rank.clear();
+        if (m_filtered)
+            setFilter(m_query);
+        else
+            setRows(QVector<int>(), false, m_rank);
+    }
+    void applySort(const QVector<int> &order, const SortKeysPtr &keys) {
+        m_sortRunning = false;
+        m_sorted = true;
+        m_sortKeys = keys;
+        m_sortedOrder = m_sortOrder;
+        m_order = order;
+        for (int row = order.count(); row < m_cells.count(); ++row)
+            m_order << row;
+        m_rank.resize(m_order.count());
+        for (int i = 0; i < m_order.count(); ++i)
+            m_rank[m_order.at(i)] = i;
+        if (m_filtered) // the matches get ordered along with the next filter run
+            setFilter(m_query);
+        else
+            setRows(m_order, true, m_rank);
+        if (keys->cells < m_cells.offset.count()) // cells were added in the meantime
+            startSort();
+    }
+    bool isCurrentSort(int generation) const { return m_sortGeneration->loadAcquire() == generation; }
+    QVariant data(const QModelIndex &idx, int role) const override {
+        if (!idx.isValid())
+            return QVariant();
+        const int row = sourceRow(idx.row());
+        // the replaced text of the first column remains the edit value
+        const bool decorated = !showsText(idx.column());
+        switch (role) {
+            case Qt::DisplayRole:
+                return decorated ? QString() : text(row, idx.column());
+            case Qt::EditRole:
+                return text(row, idx.column());
+            case Qt::CheckStateRole:
+                if (idx.column() || !(m_flags & Checkable))
+                    return QVariant();
+                return m_checked.testBit(row) ? Qt::Checked : Qt::Unchecked;
+            case Qt::DecorationRole:
+                if (idx.column() || !(m_flags & Icons))
+                    return QVariant();
+                if (!m_icons.contains(row)) // only rows that get painted ask for it
+                    requestThumbnail(row);
+                return m_icons.value(row);
+            default:
+                return QVariant();
+        }
+    }
+    bool setData(const QModelIndex &idx, const QVariant &value, int role) override {
+        if (!idx.isValid())
+            return false;
+        const int row = sourceRow(idx.row());
+        if (role == Qt::CheckStateRole) {
+            const bool checked = value.toInt() == Qt::Checked;
+            if (m_checked.testBit(row) == checked)
+                return true;
+            if (m_flags & Exclusive) { // --radiolist, only the previously checked row needs to go
+                if (checked && m_checkedRow > -1) {
+                    m_checked.clearBit(m_checkedRow);
+                    const int view = viewRow(m_checkedRow);
+                    if (view > -1)
+                        emit dataChanged(index(view, 0), index(view, 0), QVector<int>() << Qt::CheckStateRole);
+                }
+                m_checkedRow = checked ? row : -1;
+            }
+            m_checked.setBit(row, checked);
+        } else if (role == Qt::EditRole) {
+            const int cell = row*m_cells.columns + idx.column();
+            while (m_cells.offset.count() <= cell)
+                m_cells.append(QByteArray());
+            // edits are rare, the old bytes just remain unreferenced in the pool
+            const QByteArray ba = value.toString().toUtf8();
+            m_cells.offset[cell] = m_cells.pool.size();
+            m_cells.length[cell] = ba.size();
+            m_cells.pool += ba;
+            m_index.clear(); // rebuilt with the next query
+            m_filterQuery.clear();
+            m_sortKeys.clear(); // and with the next sort
+        } else {
+            return false;
+        }
+        emit dataChanged(idx, idx, QVector<int>() << role);
+        return true;
+    }
+    Qt::ItemFlags flags(const QModelIndex &idx) const override {
+        Qt::ItemFlags flags = QAbstractTableModel::flags(idx);
+        if (m_flags & Editable)
+            flags |= Qt::ItemIsEditable;
+        if (m_flags & Checkable)
+            flags |= Qt::ItemIsUserCheckable;
+        return flags;
+    }
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override {
+        if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section < m_headers.count())
+            return m_headers.at(section);
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+private:
+    int viewRow(int row) const {
+        if (!m_mapped)
+            return row;
+        // the visible rows are ordered by their rank
+        const QVector<int> &rank = m_rowsRank;
+        QVector<int>::const_iterator it = std::lower_bound(m_rows.constBegin(), m_rows.constEnd(), row,
+                                                           [&rank](int a, int b) { return rankOf(rank, a) < rankOf(rank, b); });
+        return (it != m_rows.constEnd() && *it == row) ? it - m_rows.constBegin() : -1;
+    }
+    void startSort() {
+        m_sortGeneration->fetchAndAddOrdered(1);
+        m_sortRunning = true;
+        const int type = m_sortColumn < m_types.count() ? m_types.at(m_sortColumn) : Text;
+        // the keys hold for either direction, the order only for the same
+        const bool reuse = m_sortKeys && m_sortKeys->column == m_sortColumn && m_sortKeys->type == type;
+        QThreadPool::globalInstance()->start(new ListSorter(this, m_cells, m_sortColumn, type, m_sortOrder,
+                                                            reuse ? m_sortKeys : SortKeysPtr(),
+                                                            reuse && m_sortedOrder == m_sortOrder ? m_order : QVector<int>(),
+                                                            m_sortGeneration));
+    }
+    // swaps the visible rows, the selection and the current item stick to their source rows
+    void setRows(const QVector<int> &rows, bool mapped, const QVector<int> &rank) {
+        if (!mapped && !m_mapped)
+            return;
+        emit layoutAboutToBeChanged();
+        const QModelIndexList from = persistentIndexList();
+        QVector<int> sources;
+        sources.reserve(from.count());
+        foreach (const QModelIndex &idx, from)
+            sources << sourceRow(idx.row());
+        m_rows = rows;
+        m_rowsRank = rank;
+        m_mapped = mapped;
+        QVector<int> viewRow;
+        if (mapped && !from.isEmpty()) {
+            viewRow.fill(-1, m_cells.count());
+            for (int i = 0; i < m_rows.count(); ++i)
+                viewRow[m_rows.at(i)] = i;
+        }
+        QModelIndexList to;
+        to.reserve(from.count());
+        for (int i = 0; i < from.count(); ++i) {
+            const int row = mapped ? viewRow.at(sources.at(i)) : sources.at(i);
+            to << (row < 0 ? QModelIndex() : index(row, from.at(i).column()));
+        }
+        changePersistentIndexList(from, to);
+        emit layoutChanged();
+    }
+    void requestThumbnail(int row) const {
+        QSharedPointer<QAtomicInt> wanted(new QAtomicInt(1));
+        m_icons.insert(row, QPixmap()); // in flight
+        m_thumbnailJobs.insert(row, wanted);
+        QThreadPool::globalInstance()->start(new ThumbnailJob(const_cast<ListModel*>(this), row,
+                                                              text(row, 0), m_iconSize, wanted));
+    }
+    ListCells m_cells;
+    int m_flags;
+    QStringList m_headers;
+    QVector<int> m_types;
+    QFont m_font;
+    TextWidths m_widths;
+    QBitArray m_checked;
+    int m_checkedRow; // with Exclusive
+    mutable QHash<int, QPixmap> m_icons;
+    mutable QHash<int, QSharedPointer<QAtomicInt>> m_thumbnailJobs; // in flight, with whether they're still wanted
+    QSize m_iconSize;
+    // the visible rows when filtered or sorted, along with the rank they're ordered by
+    QVector<int> m_rows, m_rowsRank;
+    bool m_mapped;
+    // --mid-search
+    bool m_filtered, m_filterRunning;
+    QString m_query, m_filterQuery;
+    QVector<int> m_filterRows;
+    int m_filterCovered;
+    SearchIndexPtr m_index;
+    QSharedPointer<QAtomicInt> m_generation;
+    // sorting, m_order lists all source rows in sorted order and m_rank is its inverse
+    int m_sortColumn;
+    Qt::SortOrder m_sortOrder, m_sortedOrder;
+    bool m_sortRunning, m_sorted;
+    SortKeysPtr m_sortKeys; // of m_order
+    QVector<int> m_order, m_rank;
+    QSharedPointer<QAtomicInt> m_sortGeneration;
+};
+
+ThumbnailJob::ThumbnailJob(ListModel *model, int row, const QString &path, const QSize &size,
+                           const QSharedPointer<QAtomicInt> &wanted)
+: m_model(model), m_row(row), m_path(path), m_size(size), m_wanted(wanted)
+{
+}
+
+enum { ThumbnailCacheMaxBytes = 64 << 20 };
+
+// Drops the oldest thumbnails beyond ThumbnailCacheMaxBytes, once per process is plenty
+static void pruneThumbnailCache(const QString &cacheDir)
+{
+    static QAtomicInt pruned(0);
+    if (!pruned.testAndSetRelaxed(0, 1))
+        return;
+    qint64 size = 0;
+    const QFileInfoList thumbnails = QDir(cacheDir).entryInfoList(QStringList("*.png"), QDir::Files, QDir::Time); // newest first
+    for (const QFileInfo &thumbnail : thumbnails) {
+        size += thumbnail.size();
+        if (size > ThumbnailCacheMaxBytes)
+            QFile::remove(thumbnail.filePath());
+    }
+}
+
+void ThumbnailJob::run()
+{
+    QPointer<ListModel> model = m_model;
+    const int row = m_row;
+    if (!m_wanted->loadAcquire()) {
+        QMetaObject::invokeMethod(qApp, [=]() {
+            if (model)
+                model->thumbnailSkipped(row);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    static const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/qarma/thumbnails";
+    const QFileInfo info(m_path);
+    const QByteArray key = QFile::encodeName(info.absoluteFilePath()) + '@' +
+                           QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + '@' +
+                           QByteArray::number(m_size.width()) + 'x' + QByteArray::number(m_size.height());
+    const QString cached = cacheDir + '/' + QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex() + ".png";
+
+    QImage image;
+    if (!image.load(cached, "PNG")) {
+        QImageReader reader(m_path);
+        const QSize size = reader.size();
+        const bool scaled = size.isValid() && (size.width() > m_size.width() || size.height() > m_size.height());
+        if (scaled) // lets eg. jpeg decode at a fraction of the size
+            reader.setScaledSize(size.scaled(m_size, Qt::KeepAspectRatio));
+        image = reader.read();
+        if (scaled && !image.isNull() && QDir().mkpath(cacheDir) && image.save(cached, "PNG"))
+            pruneThumbnailCache(cacheDir);
+    }
+
+    QMetaObject::invokeMethod(qApp, [=]() {
+        if (model)
+            model->setThumbnail(row, image);
+    }, Qt::QueuedConnection);
+}
+
+ListFilter::ListFilter(ListModel *model, const ListCells &cells, const SearchIndexPtr &index, const QString &query,
+                       const QString &previousQuery, const QVector<int> &previousRows, int previousCovered,
+                       const QVector<int> &rank, const QSharedPointer<QAtomicInt> &generation)
+: m_model(model), m_cells(cells), m_index(index), m_query(query)
+, m_previousQuery(previousQuery), m_previousRows(previousRows), m_rank(rank), m_previousCovered(previousCovered)
+, m_generation(generation), m_myGeneration(generation->loadAcquire())
+{
+}
+
+void ListFilter::run()
+{
+    // bring the index up to date with the snapshot
+    SearchIndexPtr index = m_index;
+    if (!index || index->cells < m_cells.offset.count()) {
+        SearchIndex *extended = index ? new SearchIndex(*index) : new SearchIndex;
+        if (extended->cells % m_cells.columns) { // the incomplete last row
+            extended->rowStart.removeLast();
+            extended->text.truncate(extended->rowStart.last());
+        }
+        extended->cells = m_cells.offset.count();
+        for (int row = extended->rows(); row < m_cells.count(); ++row) {
+            if (!(row % 4096) && canceled()) {
+                delete extended;
+                return;
+            }
+            for (int column = 0; column < m_cells.columns; ++column) {
+                extended->text += m_cells.text(row, column).toCaseFolded();
+                extended->text += column + 1 < m_cells.columns ? QChar(0x1f) : QChar('\n');
+            }
+            extended->rowStart << extended->text.size();
+        }
+        index = SearchIndexPtr(extended);
+    }
+
+    const QStringMatcher matcher(m_query, Qt::CaseSensitive);
+    const QVector<int> &rowStart = index->rowStart;
+    QVector<int> rows;
+    int from = 0;
+    if (!m_previousQuery.isEmpty() && m_query.contains(m_previousQuery)) {
+        // narrowing down, only the previous matches and rows added or completed since can match
+        for (int i = 0; i < m_previousRows.count(); ++i) {
+            if (!(i % 4096) && canceled())
+                return;
+            const int row = m_previousRows.at(i);
+            if (row < m_previousCovered && matcher.indexIn(index->text.constData() + rowStart.at(row), rowStart.at(row+1) - rowStart.at(row)) > -1)
+                rows << row;
+        }
+        from = m_previousCovered;
+    }
+    // one pass over the remaining text, every hit skips to the next row
+    int pos = rowStart.at(from);
+    int row = from;
+    while ((pos = matcher.indexIn(index->text, pos)) > -1) {
+        row = std::upper_bound(rowStart.constBegin() + row, rowStart.constEnd(), pos) - rowStart.constBegin() - 1;
+        rows << row;
+        pos = rowStart.at(row + 1);
+        if (!(rows.count() % 4096) && canceled())
+            return;
+    }
+
+    // in the order of the view
+    const QVector<int> &rank = m_rank;
+    std::sort(rows.begin(), rows.end(), [&rank](int a, int b) { return rankOf(rank, a) < rankOf(rank, b); });
+
+    QPointer<ListModel> model = m_model;
+    const int generation = m_myGeneration;
+    const QString query = m_query;
+    QMetaObject::invokeMethod(qApp, [=]() {
+        if (model && model->isCurrent(generation))
+            model->applyFilter(query, rows, rank, index);
+    }, Qt::QueuedConnection);
+}
+
+ListSorter::ListSorter(ListModel *model, const ListCells &cells, int column, int type, Qt::SortOrder order,
+                       const SortKeysPtr &keys, const QVector<int> &previous, const QSharedPointer<QAtomicInt> &generation)
+: m_model(model), m_cells(cells), m_column(column), m_type(type), m_order(order), m_keys(keys), m_previous(previous)
+, m_generation(generation), m_myGeneration(generation->loadAcquire())
+{
+}
+
+// "1.5 MiB", "12k", "300 B" - binary multiples, like du -h and ls -h print them
+static double sizeKey(const QString &text, bool *ok)
+{
+    const QString s = text.trimmed();
+    int digits = 0;
+    while (digits < s.size() && (s.at(digits).isDigit() || s.at(digits) == '.' || s.at(digits) == ','))
+        ++digits;
+    double value = QLocale::c().toDouble(s.left(digits), ok);
+    if (!*ok)
+        value = QLocale().toDouble(s.left(digits), ok);
+    const QString unit = s.mid(digits).trimmed().toUpper();
+    static const char prefixes[] = "KMGTPE";
+    const char *prefix = unit.isEmpty() ? NULL : strchr(prefixes, unit.at(0).toLatin1());
+    if (prefix && *prefix)
+        value *= std::pow(1024.0, prefix - prefixes + 1);
+    return value;
+}
+
+static QDateTime startOfDay(const QDate &date)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return date.startOfDay();
+#else
+    return QDateTime(date);
+#endif
+}
+
+static double dateKey(const QString &text, bool *ok)
+{
+    const QString s = text.trimmed();
+    QDateTime date = QDateTime::fromString(s, Qt::ISODate);
+    if (!date.isValid())
+        date = QDateTime::fromString(s, Qt::RFC2822Date);
+    if (!date.isValid())
+        date = startOfDay(QDate::fromString(s, Qt::ISODate));
+    if (!date.isValid())
+        date = QLocale().toDateTime(s, QLocale::ShortFormat);
+    if (!date.isValid())
+        date = startOfDay(QLocale().toDate(s, QLocale::ShortFormat));
+    if (!date.isValid()) { // seconds since the epoch
+        const qint64 seconds = s.toLongLong(ok);
+        return *ok ? seconds * 1000.0 : 0;
+    }
+    *ok = true;
+    return date.toMSecsSinceEpoch();
+}
+
+void ListSorter::run()
+{
+    // bring the keys up to date with the snapshot, an incomplete last row gets its key again
+    SortKeysPtr keys = m_keys;
+    const int known = keys ? keys->cells / m_cells.columns : 0; // complete rows with a key
+    if (!keys || keys->cells < m_cells.offset.count()) {
+        SortKeys *extended = keys ? new SortKeys(*keys) : new SortKeys(m_column, m_type);
+        if (extended->cells % m_cells.columns)
+            extended->removeLast();
+        extended->cells = m_cells.offset.count();
+        QCollator collator;
+        collator.setNumericMode(true);
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+        extended->valid.resize(m_cells.count());
+        for (int row = extended->rows(); row < m_cells.count(); ++row) {
+            if (!(row % 4096) && canceled()) {
+                delete extended;
+                return;
+            }
+            const QString text = m_cells.text(row, m_column);
+            if (m_type == ListModel::Text) {
+                extended->text.push_back(collator.sortKey(text));
+                continue;
+            }
+            bool ok = false;
+            double key;
+            if (m_type == ListModel::Size) {
+                key = sizeKey(text, &ok);
+            } else if (m_type == ListModel::Date) {
+                key = dateKey(text, &ok);
+            } else {
+                key = QLocale::c().toDouble(text.trimmed(), &ok);
+                if (!ok)
+                    key = QLocale().toDouble(text.trimmed(), &ok);
+            }
+            extended->number << key;
+            extended->valid.setBit(row, ok);
+        }
+        keys = SortKeysPtr(extended);
+    }
+
+    // rows with unparsable values go last in either direction, ties keep the source order
+    const SortKeys &k = *keys;
+    const bool ascending = m_order == Qt::AscendingOrder;
+    auto lessThan = [&k, ascending](int a, int b) {
+        if (k.type == ListModel::Text) {
+            const int c = k.text[a].compare(k.text[b]);
+            return ascending ? c < 0 : c > 0;
+        }
+        if (k.valid.testBit(a) != k.valid.testBit(b))
+            return k.valid.testBit(a);
+        return ascending ? k.number.at(a) < k.number.at(b) : k.number.at(a) > k.number.at(b);
+    };
+
+    // the previous order of the rows that were complete back then, followed by the new ones
+    QVector<int> sorted;
+    sorted.reserve(known);
+    foreach (int row, m_previous) {
+        if (row < known)
+            sorted << row;
+    }
+    if (sorted.count() != known)
+        sorted.clear();
+    QVector<int> added;
+    added.reserve(m_cells.count() - sorted.count());
+    for (int row = sorted.count(); row < m_cells.count(); ++row)
+        added << row;
+    std::stable_sort(added.begin(), added.end(), lessThan);
+    if (canceled())
+        return;
+    // all previous rows precede the added ones in the source, so ties still keep its order
+    QVector<int> order(sorted.count() + added.count());
+    std::merge(sorted.constBegin(), sorted.constEnd(), added.constBegin(), added.constEnd(), order.begin(), lessThan);
+
+    QPointer<ListModel> model = m_model;
+    const int generation = m_myGeneration;
+    QMetaObject::invokeMethod(qApp, [=]() {
+        if (model && model->isCurrentSort(generation))
+            model->applySort(order, keys);
+    }, Qt::QueuedConnection);
+}
+
+// the selected rows or, for check- and radiolists, the checked ones - by default their first
+// column with text, otherwise the --print-column ones, read straight from the cell pool
+static void printList(const QTreeView *tw, OutputWriter &out)
+{
+    const ListModel *model = static_cast<const ListModel*>(tw->model());
+    const ListCells &cells = model->cells();
+    const QVariantList printColumns = tw->property("qarma_print_columns").toList();
+    QVector<int> columns;
+    foreach (const QVariant &column, printColumns)
+        columns << column.toInt();
+    const QModelIndexList selection = tw->selectionModel()->selectedRows();
+    const bool checked = selection.isEmpty(); // checkable
+    if (columns.isEmpty())
+        columns << (checked ? 1 : -1); // -1: what the first column displays
+    const int rows = checked ? model->count() : selection.count();
+    int size;
+    for (int i = 0; i < rows; ++i) {
+        if (checked && !model->isChecked(i))
+            continue;
+        const int row = checked ? i : model->sourceRow(selection.at(i).row());
+        out.beginRecord();
+        foreach (const int column, columns) {
+            if (column < 0 && !model->showsText(0))
+                out.field("", 0);
+            else if (column >= cells.columns)
+                out.field("", 0);
+            else {
+                const char *utf8 = cells.utf8(row, qMax(column, 0), &size);
+                out.field(utf8, size);
+            }
+        }
+        out.endRecord();
+    }
+}
+
+// --print-column: ALL or a comma separated list of column numbers, 1-based like zenity
+static bool parsePrintColumn(const QString &value, bool *all, QVariantList *columns)
+{
+    *all = value.compare("ALL", Qt::CaseInsensitive) == 0;
+    if (*all)
+        return true;
+    foreach (const QString &column, value.split(',')) {
+        bool ok;
+        const int n = column.trimmed().toInt(&ok);
+        if (!ok || n < 1)
+            return false;
+        *columns << n - 1;
+    }
+    return true;
+}
+
+char Qarma::showList(const QStringList &args)
+{
+    NEW_DIALOG
+
+    QLabel *lbl;
+    vl->addWidget(lbl = new QLabel(dlg));
+
+    QTreeView *tw;
+    vl->addWidget(tw = new QTreeView(dlg));
+    tw->setUniformRowHeights(true);
+    tw->setSelectionBehavior(QAbstractItemView::SelectRows);
+    tw->setSelectionMode(QAbstractItemView::SingleSelection);
+    tw->setRootIsDecorated(false);
+    tw->setAllColumnsShowFocus(true);
 
     bool editable(false), checkable(false), exclusive(false), icons(false), ok, needFilter(true);
     QStringList columns;
+    QString printColumn;
+    QVector<int> types;
     QStringList values;
     QList<int> hiddenCols;
     dlg->setProperty("qarma_separator", "|");
+    values.reserve(args.count());
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text")
+        if (!args.at(i).startsWith(QLatin1String("--"))) { // the bulk, don't run it through the options
+            values << args.at(i);
+            continue;
+        }
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             lbl->setText(labelText(NEXT_ARG));
-        else if (args.at(i) == "--multiple")
+            continue;
+        }
+        OPTION("--multiple") {
             tw->setSelectionMode(QAbstractItemView::ExtendedSelection);
-        else if (args.at(i) == "--column") {
-            columns << NEXT_ARG;
-        } else if (args.at(i) == "--editable")
+            continue;
+        }
+        OPTION("--column") {
+            QString column = NEXT_ARG;
+            static const QStringList typeNames = QStringList() << "text" << "numeric" << "date" << "size";
+            const int colon = column.lastIndexOf(':');
+            const int type = colon < 0 ? -1 : typeNames.indexOf(column.mid(colon + 1).toLower());
+            if (type > -1)
+                column.truncate(colon);
+            columns << column;
+            types << qMax(type, int(ListModel::Text));
+            continue;
+        }
+        OPTION("--editable") {
             editable = true;
-        else if (args.at(i) == "--hide-header")
+            continue;
+        }
+        OPTION("--hide-header") {
             tw->setHeaderHidden(true);
-        else if (args.at(i) == "--separator")
+            continue;
+        }
+        OPTION("--separator") {
             dlg->setProperty("qarma_separator", NEXT_ARG);
-        else if (args.at(i) == "--hide-column") {
+            continue;
+        }
+        OPTION("--hide-column") {
             int v = NEXT_ARG.toInt(&ok);
             if (ok)
                 hiddenCols << v-1;
-        } else if (args.at(i) == "--print-column") {
-            qWarning("TODO: --print-column");
-        } else if (args.at(i) == "--checklist") {
+            continue;
+        }
+        OPTION("--print-column") {
+            printColumn = NEXT_ARG;
+            continue;
+        }
+        OPTION("--checklist") {
             tw->setSelectionMode(QAbstractItemView::NoSelection);
             tw->setAllColumnsShowFocus(false);
             checkable = true;
-        } else if (args.at(i) == "--radiolist") {
+            continue;
+        }
+        OPTION("--radiolist") {
             tw->setSelectionMode(QAbstractItemView::NoSelection);
             tw->setAllColumnsShowFocus(false);
             checkable = true;
             exclusive = true;
-        } else if (args.at(i) == "--imagelist") {
+            continue;
+        }
+        OPTION("--imagelist") {
             icons = true;
-        } else if (args.at(i) == "--mid-search") {
+            continue;
+        }
+        OPTION("--mid-search") {
             if (needFilter) {
                 needFilter = false;
                 QLineEdit *filter;
                 vl->addWidget(filter = new QLineEdit(dlg));
                 filter->setPlaceholderText(tr("Filter"));
                 connect (filter, &QLineEdit::textChanged, this, [=](const QString &match){
-                    for (int i = 0; i < tw->topLevelItemCount(); ++i)
-                        tw->topLevelItem(i)->setHidden(!tw->topLevelItem(i)->text(0).contains(match, Qt::CaseInsensitive));
+                    static_cast<ListModel*>(tw->model())->setFilter(match);
                 });
             }
-        } else if (args.at(i) != "--list") {
-            values << args.at(i);
+            continue;
+        }
+        OPTION("--list") continue;
+        default: break;
         }
+        values << args.at(i); // unknown options are values as well
     }
+
     if (values.isEmpty())
         listenToStdIn();
 
     if (checkable)
         editable = false;
 
-    tw->setProperty("qarma_list_flags", int(editable | checkable << 1 | icons << 2));
+    // ALL skips the checkmarks
+    if (!printColumn.isNull()) {
+        QVariantList printColumns;
+        bool all;
+        if (!parsePrintColumn(printColumn, &all, &printColumns))
+            return !error("--print-column must be followed by ALL or a comma separated list of column numbers");
+        for (int i = checkable; all && i < qMax(columns.count(), 1); ++i)
+            printColumns << i;
+        tw->setProperty("qarma_print_columns", printColumns);
+    }
 
-    int columnCount = qMax(columns.count(), 1);
-    tw->setColumnCount(columnCount);
-    tw->setHeaderLabels(columns);
+    ListModel *model = new ListModel(columns.count(), int(editable | checkable << 1 | icons << 2 | exclusive << 3), tw);
+    model->setHeaders(columns);
+    model->setColumnTypes(types);
+    model->setFont(tw->font());
+    // what the checkmark or icon adds to the first column
+    const int decorationMargin = 2 * (tw->style()->pixelMetric(QStyle::PM_FocusFrameHMargin, 0, tw) + 1);
+    if (checkable)
+        tw->setProperty("qarma_decoration", tw->style()->pixelMetric(QStyle::PM_IndicatorWidth, 0, tw) + decorationMargin);
+    if (icons) {
+        const int size = tw->style()->pixelMetric(QStyle::PM_SmallIconSize, 0, tw);
+        model->setIconSize(QSize(size, size) * tw->devicePixelRatioF());
+        tw->setProperty("qarma_decoration", tw->property("qarma_decoration").toInt() + size + decorationMargin);
+    }
+    model->addCells(values);
+    values.clear();
+    tw->setModel(model);
+    if (icons) { // thumbnails still queued for rows that went out of view are skipped
+        auto keepVisible = [=]() {
+            const QModelIndex first = tw->indexAt(QPoint(0, 0));
+            const QModelIndex last = tw->indexAt(tw->viewport()->rect().bottomLeft());
+            model->keepThumbnails(first.isValid() ? first.row() : 0, last.isValid() ? last.row() : model->rowCount() - 1);
+        };
+        connect(tw->verticalScrollBar(), &QScrollBar::valueChanged, model, keepVisible);
+        connect(model, &QAbstractItemModel::layoutChanged, model, keepVisible);
+    }
     foreach (const int &i, hiddenCols)
         tw->setColumnHidden(i, true);
-
-    addItems(tw, values, editable, checkable, icons);
-
-    if (exclusive) {
-        connect (tw, SIGNAL(itemChanged(QTreeWidgetItem*, int)), SLOT(toggleItems(QTreeWidgetItem*, int)));
-    }
-    for (int i = 0; i < columns.count(); ++i)
-        tw->resizeColumnToContents(i);
+    tw->header()->setSortIndicator(-1, Qt::AscendingOrder); // keep the given order until a header is clicked
+    tw->setSortingEnabled(true);
+    fitColumns(tw, model->textWidths(), columns.count(), tw->property("qarma_decoration").toInt());
 
     FINISH_DIALOG(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
     SHOW_DIALOG
@@ -902,17 +2478,28 @@ char Qarma::showList(const QStringList &args)
 
 void Qarma::notify(const QString message, bool noClose)
 {
-    if (QDBusConnection::sessionBus().interface()->isServiceRegistered("org.freedesktop.Notifications")) {
-        QDBusInterface notifications("org.freedesktop.Notifications", "/org/freedesktop/Notifications", "org.freedesktop.Notifications");
+    static int registered = -1; // that's a roundtrip, ask only once
+    if (registered < 0) {
+        registered = QDBusConnection::sessionBus().interface()->isServiceRegistered("org.freedesktop.Notifications");
+        StartupTrace::mark("D-Bus");
+    }
+    if (registered) {
+        if (m_notifyCall) { // a burst, only the latest message is sent once the pending one returns
+            m_pendingNotification = message;
+            return;
+        }
+        if (!m_notifications)
+            m_notifications = new QDBusInterface("org.freedesktop.Notifications", "/org/freedesktop/Notifications",
+                                                 "org.freedesktop.Notifications", QDBusConnection::sessionBus(), this);
         const QString summary = (message.length() < 32) ? message : message.left(25) + "...";
         QVariantMap hintMap;
         QStringList hintList = m_notificationHints.split(':');
         for (int i = 0; i < hintList.count() - 1; i+=2)
             hintMap.insert(hintList.at(i), hintList.at(i+1));
-        QDBusMessage msg = notifications.call("Notify", "Qarma", m_notificationId, "dialog-information", summary, message,
-                                              QStringList() /*actions*/, hintMap, m_timeout);
-        if (msg.arguments().count())
-            m_notificationId = msg.arguments().at(0).toUInt();
+        m_notifyCall = new QDBusPendingCallWatcher(m_notifications->asyncCall("Notify", "Qarma", m_notificationId,
+                                                        "dialog-information", summary, message,
+                                                        QStringList() /*actions*/, hintMap, m_timeout), this);
+        connect(m_notifyCall, &QDBusPendingCallWatcher::finished, this, &Qarma::notificationSent);
         return;
     }
 
@@ -935,30 +2522,266 @@ void Qarma::notify(const QString message, bool noClose)
     dlg->move(QGuiApplication::screens().at(0)->availableGeometry().topRight() - QPoint(dlg->width() + 20, -20));
 }
 
+void Qarma::notificationSent(QDBusPendingCallWatcher *call)
+{
+    QDBusPendingReply<uint> reply = *call;
+    if (!reply.isError())
+        m_notificationId = reply.value(); // the next message replaces this one
+    call->deleteLater();
+    m_notifyCall = NULL;
+    if (!m_pendingNotification.isNull()) {
+        const QString message = m_pendingNotification;
+        m_pendingNotification = QString();
+        notify(message);
+    }
+}
+
 char Qarma::showNotification(const QStringList &args)
 {
     QString message;
     bool listening(false);
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             message = NEXT_ARG;
-        } else if (args.at(i) == "--listen") {
+            continue;
+        }
+        OPTION("--listen") {
             listening = true;
             listenToStdIn();
-        } else if (args.at(i) == "--hint") {
+            continue;
+        }
+        OPTION("--hint") {
             m_notificationHints = NEXT_ARG;
-        } else if (args.at(i) == "--selectable-labels") {
+            continue;
+        }
+        OPTION("--selectable-labels") {
             m_selectableLabel = true;
-        } else { WARN_UNKNOWN_ARG("--notification") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--notification")
     }
     if (!message.isEmpty())
         notify(message, listening);
-    if (!(listening || m_dialog))
-        QMetaObject::invokeMethod(this, "quit", Qt::QueuedConnection);
+    if (!(listening || m_dialog)) {
+        if (m_notifyCall) // don't quit before the message made it out
+            connect(m_notifyCall, SIGNAL(finished(QDBusPendingCallWatcher*)), SLOT(quit()));
+        else
+            QMetaObject::invokeMethod(this, "quit", Qt::QueuedConnection);
+    }
     return 0;
 }
 
+// Reads stdin on its own thread, so blocking reads, decoding and line splitting stay off
+// the GUI thread. Batches are handed over through a lock-free single producer, single
+// consumer queue and the receivers readStdIn() slot is invoked when there's something new.
+// The queue holds at most MaxQueued batches of up to 64kB, a producer that outpaces the GUI
+// blocks in write() like it did when we read on demand.
+class StdinReader : public QThread
+{
+public:
+    struct Batch {
+        Batch() : eof(false) {}
+        QStringList lines; // everything but TextInfo
+        QString text; // TextInfo
+        bool eof;
+    };
+    enum { MaxQueued = 16 };
+    StdinReader(QObject *receiver, bool text) : QThread(), m_receiver(receiver), m_text(text), m_free(MaxQueued) {
+        m_head = m_tail = new Node;
+    }
+    // consumer side
+    bool pop(Batch &batch) {
+        Node *next = m_head->next.loadAcquire();
+        if (!next)
+            return false;
+        batch = next->batch;
+        next->batch = Batch();
+        delete m_head;
+        m_head = next; // "next" is the new dummy
+        m_free.release();
+        return true;
+    }
+    void rearm() { m_notified.storeRelease(0); }
+protected:
+    void run() override {
+        QTextDecoder *decoder = QTextCodec::codecForLocale()->makeDecoder(); // chunks can end inside a multibyte sequence
+        QByteArray carry;
+        char buffer[64*1024];
+        while (true) {
+            const ssize_t n = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR)
+                continue;
+            Batch batch;
+            batch.eof = n <= 0;
+            if (m_text) {
+                if (n > 0)
+                    batch.text = decoder->toUnicode(buffer, n);
+            } else {
+                // split off complete lines, the incomplete tail waits for more
+                if (n > 0)
+                    carry.append(buffer, n);
+                int end = batch.eof ? carry.size() : 0;
+                for (int i = n - 1; i >= 0 && !end; --i) {
+                    if (buffer[i] == '\n')
+                        end = carry.size() - n + i + 1;
+                }
+                if (end > 0) {
+                    QByteArray lines = carry.left(end);
+                    carry.remove(0, end);
+                    if (lines.endsWith('\n'))
+                        lines.chop(1);
+                    batch.lines = QString::fromLocal8Bit(lines).split('\n');
+                }
+            }
+            if (!batch.lines.isEmpty() || !batch.text.isEmpty() || batch.eof)
+                push(batch);
+            if (batch.eof)
+                break;
+        }
+        delete decoder;
+    }
+private:
+    struct Node {
+        Batch batch;
+        QAtomicPointer<Node> next;
+    };
+    void push(const Batch &batch) {
+        m_free.acquire(); // wait for the GUI to catch up
+        Node *node = new Node;
+        node->batch = batch;
+        m_tail->next.storeRelease(node);
+        m_tail = node;
+        if (m_notified.testAndSetOrdered(0, 1))
+            QMetaObject::invokeMethod(m_receiver, "readStdIn", Qt::QueuedConnection);
+    }
+    QObject *m_receiver;
+    bool m_text;
+    Node *m_head; // consumer
+    Node *m_tail; // producer
+    QAtomicInt m_notified;
+    QSemaphore m_free;
+};
+
 static QFile *gs_stdin = 0;
+static StdinReader *gs_reader = 0;
+static QString gs_cachedText;
+
+// Elements whose tags don't nest what follows them for the purpose of streaming: the document
+// frame, elements with optional end tags and void elements.
+static bool isFlatHtmlElement(const QString &name)
+{
+    static const QStringList flat = QStringList() << "html" << "head" << "body" << "p" << "li" << "dt" << "dd"
+                                    << "tr" << "td" << "th" << "thead" << "tbody" << "tfoot" << "option"
+                                    << "br" << "hr" << "img" << "input" << "meta" << "link" << "area" << "base"
+                                    << "col" << "embed" << "param" << "source" << "track" << "wbr";
+    return flat.contains(name);
+}
+
+// Returns where the HTML in text can be cut so that no element spans the cut, 0 if nowhere yet.
+// The scan resumes where the last one stopped, state lives in the "qarma_html_*" properties of te.
+// Style sheets are collected into "qarma_html_style" to apply them to the later parts as well.
+static int htmlCut(QTextEdit *te, const QString &text)
+{
+    int pos = te->property("qarma_html_scanned").toInt();
+    int depth = te->property("qarma_html_depth").toInt();
+    int cut = 0, lastTag = 0;
+    while (pos < text.length()) {
+        const int open = text.indexOf('<', pos);
+        if (open < 0) {
+            if (!depth) // plain text, complete lines are
+                cut = qMax(cut, text.lastIndexOf('\n') + 1);
+            pos = text.length();
+            break;
+        }
+        pos = open;
+        if (!depth)
+            cut = open;
+        int close = text.indexOf('>', open);
+        if (close < 0)
+            break;
+        if (text.midRef(open, 4) == QLatin1String("<!--")) {
+            close = text.indexOf("-->", open + 4);
+            if (close < 0)
+                break;
+            close += 2;
+        } else if (text.at(open + 1) != '!' && text.at(open + 1) != '?') {
+            const bool closing = text.at(open + 1) == '/';
+            int nameEnd = open + 1 + closing;
+            while (nameEnd < close && text.at(nameEnd).isLetterOrNumber())
+                ++nameEnd;
+            const QString name = text.mid(open + 1 + closing, nameEnd - open - 1 - closing).toLower();
+            const bool selfClosing = text.at(close - 1) == '/';
+            if (!closing && !selfClosing && (name == "style" || name == "script")) {
+                // raw text, skip to the end tag
+                const int endTag = text.indexOf("</" + name, close, Qt::CaseInsensitive);
+                const int endClose = endTag < 0 ? -1 : text.indexOf('>', endTag);
+                if (endClose < 0)
+                    break;
+                if (name == "style")
+                    te->setProperty("qarma_html_style", te->property("qarma_html_style").toString() +
+                                                        text.mid(open, endClose + 1 - open));
+                close = endClose;
+            } else if (!selfClosing && !isFlatHtmlElement(name)) {
+                depth = qMax(0, depth + (closing ? -1 : 1)); // stray end tags don't count
+            }
+        }
+        pos = lastTag = close + 1;
+        if (!depth)
+            cut = pos;
+    }
+    // an element that doesn't close (eg. everything in one <div>) must not hold the rest back
+    // forever, it is cut after its last complete tag and loses its formatting for the rest
+    if (!cut && lastTag > (1 << 16))
+        cut = lastTag;
+    te->setProperty("qarma_html_scanned", pos - cut);
+    te->setProperty("qarma_html_depth", depth);
+    return cut;
+}
+
+// Appends at the end of the document, so the cost only depends on the new text.
+// HTML is appended in parts no element spans, the tail with open elements stays in text.
+static void appendText(QTextEdit *te, QString &text, bool flush)
+{
+    if (text.isEmpty())
+        return;
+    const bool html = te->property("qarma_html").toBool();
+    const int cut = !html || flush ? text.length() : htmlCut(te, text);
+    if (!cut)
+        return;
+
+    QTextDocument *doc = te->document();
+    const bool undo = doc->isUndoRedoEnabled();
+    doc->setUndoRedoEnabled(false); // the streamed text is not an edit
+    QTextCursor end(doc);
+    end.movePosition(QTextCursor::End);
+    if (html)
+        end.insertHtml(te->property("qarma_html_style").toString() + text.left(cut));
+    else
+        end.insertText(text);
+    text.remove(0, cut);
+    if (flush) {
+        te->setProperty("qarma_html_scanned", 0);
+        te->setProperty("qarma_html_depth", 0);
+    }
+
+    // --max-lines is handled by the document itself, --max-chars drops whole leading blocks
+    const int maxChars = te->property("qarma_max_chars").toInt();
+    if (maxChars > 0 && doc->characterCount() > maxChars) {
+        int excess = doc->characterCount() - maxChars;
+        QTextBlock block = doc->firstBlock();
+        while (excess > 0 && block.isValid() && block != doc->lastBlock()) {
+            excess -= block.length();
+            block = block.next();
+        }
+        QTextCursor cursor(doc);
+        cursor.setPosition(block.position(), QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+    }
+    doc->setUndoRedoEnabled(undo);
+}
 
 void Qarma::finishProgress()
 {
@@ -977,84 +2800,100 @@ void Qarma::finishProgress()
     }
 }
 
+void Qarma::updateProgress()
+{
+    Q_ASSERT(m_type == Progress);
+    m_progressTimer->stop();
+    if (!m_progressLabelPending && m_progressValue < 0)
+        return;
+
+    QProgressDialog *dlg = static_cast<QProgressDialog*>(m_dialog);
+    const int oldValue = dlg->value();
+    if (m_progressLabelPending)
+        dlg->setLabelText(labelText(m_progressLabel));
+    if (m_progressValue > -1)
+        dlg->setValue(m_progressValue);
+    m_progressLabelPending = false;
+    m_progressValue = -1;
+
+    if (dlg->maximum() == 0)
+        return; // we just need the label support
+
+    if (dlg->value() == 100) {
+        finishProgress();
+    } else if (oldValue == 100) {
+        disconnect (dlg, SIGNAL(canceled()), dlg, SLOT(accept()));
+        connect (dlg, SIGNAL(canceled()), dlg, SLOT(reject()));
+        dlg->setCancelButtonText(m_cancel.isNull() ? tr("Cancel") : m_cancel);
+    } else if (dlg->property("qarma_eta").toBool()) {
+        static QDateTime starttime;
+        if (starttime.isNull()) {
+            starttime = QDateTime::currentDateTime();
+        } else if (dlg->value() > 0) {
+            const qint64 secs = starttime.secsTo(QDateTime::currentDateTime());
+            QString eta = QTime(0,0,0).addSecs(100 * secs / dlg->value() - secs).toString();
+            foreach (QWidget *w, dlg->findChildren<QWidget*>())
+                w->setToolTip(eta);
+        }
+    }
+}
+
 void Qarma::readStdIn()
 {
     if (!gs_stdin->isOpen())
         return;
-    QSocketNotifier *notifier = qobject_cast<QSocketNotifier*>(sender());
-    if (notifier)
-        notifier->setEnabled(false);
 
-    QByteArray ba = m_type == TextInfo ? gs_stdin->readAll() : gs_stdin->readLine();
-    if (ba.isEmpty() && notifier) {
-        gs_stdin->close();
-//         gs_stdin->deleteLater(); // hello segfault...
-//         gs_stdin = NULL;
-        notifier->deleteLater();
-        return;
+    // drain whatever is there into one batch, but don't starve the event loop on a firehose
+    gs_reader->rearm();
+    StdinReader::Batch batch, more;
+    QElapsedTimer budget;
+    budget.start();
+    while (!batch.eof && gs_reader->pop(more)) {
+        batch.lines += more.lines;
+        batch.text += more.text;
+        batch.eof = more.eof;
+        if (budget.elapsed() > 8) {
+            QMetaObject::invokeMethod(this, "readStdIn", Qt::QueuedConnection);
+            break;
+        }
     }
 
-    static QString cachedText;
-    QString newText = QString::fromLocal8Bit(ba);
-    if (newText.isEmpty() && cachedText.isEmpty()) {
-        if (notifier)
-            notifier->setEnabled(true);
+    const QString &newText = batch.text;
+    const QStringList &input = batch.lines;
+    if (input.isEmpty() && newText.isEmpty() && gs_cachedText.isEmpty() && !batch.eof)
         return;
-    }
 
-    QStringList input;
-    if (m_type != TextInfo) {
-        if (newText.endsWith('\n'))
-            newText.resize(newText.length()-1);
-        input = newText.split('\n');
-    }
     if (m_type == Progress) {
-        QProgressDialog *dlg = static_cast<QProgressDialog*>(m_dialog);
-
-        const int oldValue = dlg->value();
-        bool ok;
-        foreach (QString line, input) {
+        // only the latest state matters, it's applied once per update interval - so only the
+        // last label and the last valid value of the batch need to be looked at
+        bool label = false, value = false, ok;
+        for (int i = input.count() - 1; i >= 0 && !(label && value); --i) {
+            const QString &line = input.at(i);
             if (line.startsWith('#')) {
-                dlg->setLabelText(labelText(line.mid(1)));
-            } else {
+                if (!label) {
+                    m_progressLabel = line.mid(1);
+                    m_progressLabelPending = label = true;
+                }
+            } else if (!value) {
                 static const QRegularExpression nondigit("[^0-9]");
                 int u = line.section(nondigit,0,0).toInt(&ok);
-                if (ok)
-                    dlg->setValue(qMin(100,u));
-            }
-        }
-
-        if (dlg->maximum() == 0)
-            return; // we just need the label support
-
-        if (dlg->value() == 100) {
-            finishProgress();
-        } else if (oldValue == 100) {
-            disconnect (dlg, SIGNAL(canceled()), dlg, SLOT(accept()));
-            connect (dlg, SIGNAL(canceled()), dlg, SLOT(reject()));
-            dlg->setCancelButtonText(m_cancel.isNull() ? tr("Cancel") : m_cancel);
-        } else if (dlg->property("qarma_eta").toBool()) {
-            static QDateTime starttime;
-            if (starttime.isNull()) {
-                starttime = QDateTime::currentDateTime();
-            } else if (dlg->value() > 0) {
-                const qint64 secs = starttime.secsTo(QDateTime::currentDateTime());
-                QString eta = QTime(0,0,0).addSecs(100 * secs / dlg->value() - secs).toString();
-                foreach (QWidget *w, dlg->findChildren<QWidget*>())
-                    w->setToolTip(eta);
+                if (ok) {
+                    m_progressValue = qMin(100,u);
+                    value = true;
+                }
             }
         }
+        if (m_progressValue == 100 || !m_progressTimer->interval())
+            updateProgress(); // don't delay completion
+        else if (!m_progressTimer->isActive())
+            m_progressTimer->start();
     } else if (m_type == TextInfo) {
         if (QTextEdit *te = m_dialog->findChild<QTextEdit*>()) {
-            cachedText += newText;
+            gs_cachedText += newText;
             static QPropertyAnimation *animator = NULL;
             if (!animator || animator->state() != QPropertyAnimation::Running) {
                 const int oldValue = te->verticalScrollBar() ? te->verticalScrollBar()->value() : 0;
-                if (te->property("qarma_html").toBool())
-                    te->setHtml(te->toHtml() + cachedText);
-                else
-                    te->setPlainText(te->toPlainText() + cachedText);
-                cachedText.clear();
+                appendText(te, gs_cachedText, false);
                 if (te->verticalScrollBar() && te->property("qarma_autoscroll").toBool()) {
                     te->verticalScrollBar()->setValue(oldValue);
                     if (!animator) {
@@ -1098,13 +2937,21 @@ void Qarma::readStdIn()
         if (userNeedsHelp)
             qDebug() << "icon: <filename>\nmessage: <UTF-8 encoded text>\ntooltip: <UTF-8 encoded text>\nvisible: <true|false>";
     } else if (m_type == List) {
-        if (QTreeWidget *tw = m_dialog->findChild<QTreeWidget*>()) {
-            const int twflags = tw->property("qarma_list_flags").toInt();
-            addItems(tw, input, twflags & 1, twflags & 1<<1, twflags & 1<<2);
+        if (QTreeView *tw = m_dialog->findChild<QTreeView*>()) {
+            ListModel *model = static_cast<ListModel*>(tw->model());
+            model->addCells(input);
+            fitColumns(tw, model->textWidths(), model->columnCount(), tw->property("qarma_decoration").toInt());
+        }
+    }
+
+    if (batch.eof) {
+        gs_stdin->close();
+        if (m_type == TextInfo && !gs_cachedText.isEmpty()) {
+            if (QTextEdit *te = m_dialog->findChild<QTextEdit*>())
+                appendText(te, gs_cachedText, true);
         }
+        StartupTrace::mark("stdin closed");
     }
-    if (notifier)
-        notifier->setEnabled(true);
 }
 
 void Qarma::listenToStdIn()
@@ -1113,8 +2960,9 @@ void Qarma::listenToStdIn()
         return;
     gs_stdin = new QFile;
     if (gs_stdin->open(stdin, QIODevice::ReadOnly)) {
-        QSocketNotifier *snr = new QSocketNotifier(gs_stdin->handle(), QSocketNotifier::Read, gs_stdin);
-        connect (snr, SIGNAL(activated(int)), SLOT(readStdIn()));
+        // never deleted, it might be blocked in read() when we exit
+        gs_reader = new StdinReader(this, m_type == TextInfo);
+        gs_reader->start();
     } else {
         delete gs_stdin;
         gs_stdin = NULL;
@@ -1125,28 +2973,57 @@ char Qarma::showProgress(const QStringList &args)
 {
     QProgressDialog *dlg = new QProgressDialog;
     dlg->setRange(0, 101);
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setSingleShot(true);
+    m_progressTimer->setInterval(16); // ~ one frame
+    connect (m_progressTimer, SIGNAL(timeout()), SLOT(updateProgress()));
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text")
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             dlg->setLabelText(labelText(NEXT_ARG));
-        else if (args.at(i) == "--percentage")
+            continue;
+        }
+        OPTION("--percentage") {
             dlg->setValue(NEXT_ARG.toUInt());
-        else if (args.at(i) == "--pulsate")
+            continue;
+        }
+        OPTION("--pulsate") {
             dlg->setRange(0,0);
-        else if (args.at(i) == "--auto-close")
+            continue;
+        }
+        OPTION("--auto-close") {
             dlg->setProperty("qarma_autoclose", true);
-        else if (args.at(i) == "--auto-kill")
+            continue;
+        }
+        OPTION("--auto-kill") {
             dlg->setProperty("qarma_autokill_parent", true);
-        else if (args.at(i) == "--no-cancel") {
+            continue;
+        }
+        OPTION("--no-cancel") {
             if (QPushButton *btn = dlg->findChild<QPushButton*>())
                 btn->hide();
-        } else if (args.at(i) == "--time-remaining") {
+            continue;
+        }
+        OPTION("--time-remaining") {
             dlg->setProperty("qarma_eta", true);
+            continue;
         }
-        else { WARN_UNKNOWN_ARG("--progress") }
+        OPTION("--update-interval") {
+            bool ok;
+            const int ms = NEXT_ARG.toUInt(&ok);
+            if (!ok)
+                return !error("--update-interval must be followed by a positive number");
+            m_progressTimer->setInterval(ms);
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--progress")
     }
 
     listenToStdIn();
     if (dlg->maximum() == 0) { // pulsate, quit as stdin closes
+        connect (gs_stdin, SIGNAL(aboutToClose()), this, SLOT(updateProgress()));
         connect (gs_stdin, SIGNAL(aboutToClose()), this, SLOT(finishProgress()));
     }
 
@@ -1183,31 +3060,157 @@ char Qarma::showScale(const QStringList &args)
 
     bool ok;
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--text")
+        switch (optionHash(args.at(i))) {
+        OPTION("--text") {
             lbl->setText(labelText(NEXT_ARG));
-        else if (args.at(i) == "--value")
+            continue;
+        }
+        OPTION("--value") {
             sld->setValue(NEXT_ARG.toInt());
-        else if (args.at(i) == "--min-value") {
+            continue;
+        }
+        OPTION("--min-value") {
             int v = NEXT_ARG.toInt(&ok);
             if (ok)
                 sld->setMinimum(v);
-        } else if (args.at(i) == "--max-value") {
+            continue;
+        }
+        OPTION("--max-value") {
             int v = NEXT_ARG.toInt(&ok);
             if (ok)
                 sld->setMaximum(v);
-        } else if (args.at(i) == "--step") {
+            continue;
+        }
+        OPTION("--step") {
             int u = NEXT_ARG.toInt(&ok);
             if (ok)
                 sld->setSingleStep(u);
-        } else if (args.at(i) == "--print-partial") {
+            continue;
+        }
+        OPTION("--print-partial") {
             connect (sld, SIGNAL(valueChanged(int)), SLOT(printInteger(int)));
-        } else if (args.at(i) == "--hide-value") {
+            continue;
+        }
+        OPTION("--hide-value") {
             val->hide();
-        } else { WARN_UNKNOWN_ARG("--scale") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--scale")
+    }
+    SHOW_DIALOG
+    return 0;
+}
+
+// Plain text files beyond this size (or with --paged) are mmap()ed and only the visible
+// lines are decoded and painted - the kernel pages the file in and out as needed.
+static const qint64 gs_pagedThreshold = 16 << 20;
+
+class MappedTextView : public QAbstractScrollArea
+{
+public:
+    MappedTextView(QFile *file, const uchar *data, QWidget *parent)
+    : QAbstractScrollArea(parent), m_file(file), m_data(data), m_mapped(file->size()), m_size(m_mapped), m_top(0)
+    , m_lastValue(0), m_width(0) {
+        file->setParent(this);
+        // the scrollbar can't cover > 2 GB in bytes
+        m_scale = m_size / INT_MAX + 1;
+        // estimate the line length from the head of the file, the scrollbar works in bytes
+        const qint64 probe = qMin<qint64>(m_size, 64 << 10);
+        const int lines = std::count(m_data, m_data + probe, '\n');
+        m_lineStep = qMax<qint64>(1, (lines ? probe / lines : probe) / m_scale);
+        verticalScrollBar()->setSingleStep(m_lineStep);
+        verticalScrollBar()->setRange(0, m_size / m_scale);
+        horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth() * 3);
+        connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &MappedTextView::scrolled);
+    }
+protected:
+    void paintEvent(QPaintEvent *) override {
+        checkSize();
+        QPainter p(viewport());
+        p.setPen(viewport()->palette().color(QPalette::Text));
+        const int lineHeight = fontMetrics().lineSpacing();
+        const int dx = horizontalScrollBar()->value();
+        QTextCodec *codec = QTextCodec::codecForLocale();
+        qint64 pos = m_top;
+        for (int y = 0; y < viewport()->height() && pos < m_size; y += lineHeight) {
+            const qint64 end = lineEnd(pos);
+            qint64 len = end - pos;
+            while (len > 0 && (m_data[pos + len - 1] == '\n' || m_data[pos + len - 1] == '\r'))
+                --len;
+            const QString line = codec->toUnicode(reinterpret_cast<const char*>(m_data + pos), len);
+            const QRect r(-dx, y, INT_MAX/2, lineHeight);
+            QRect br;
+            p.drawText(r, Qt::AlignLeft|Qt::AlignTop|Qt::TextSingleLine|Qt::TextExpandTabs, line, &br);
+            m_width = qMax(m_width, br.width());
+            pos = end;
+        }
+        horizontalScrollBar()->setRange(0, qMax(0, m_width - viewport()->width()));
+    }
+    void resizeEvent(QResizeEvent *event) override {
+        QAbstractScrollArea::resizeEvent(event);
+        const int lines = qMax(1, viewport()->height() / fontMetrics().lineSpacing());
+        verticalScrollBar()->setPageStep(qMax<qint64>(1, qMin<qint64>(INT_MAX/2, (lines - 1) * m_lineStep)));
+        horizontalScrollBar()->setPageStep(viewport()->width());
+    }
+    void scrollContentsBy(int, int) override {
+        viewport()->update();
+    }
+private:
+    static const int MaxLine = 4096; // longer lines are broken to keep every step bounded
+    qint64 lineEnd(qint64 pos) const {
+        const qint64 stop = qMin(m_size, pos + MaxLine);
+        const void *nl = memchr(m_data + pos, '\n', stop - pos);
+        return nl ? static_cast<const uchar*>(nl) - m_data + 1 : stop;
+    }
+    qint64 lineStart(qint64 pos) const {
+        for (qint64 i = pos, stop = qMax<qint64>(0, pos - MaxLine); i > stop; --i) {
+            if (m_data[i - 1] == '\n')
+                return i;
+        }
+        return qMax<qint64>(0, pos - MaxLine);
+    }
+    // reading mapped pages beyond the end of a truncated file is a SIGBUS
+    void checkSize() {
+        const qint64 size = qBound<qint64>(0, m_file->size(), m_mapped);
+        if (size == m_size)
+            return;
+        m_size = size;
+        m_top = qMin(m_top, m_size);
+        const QSignalBlocker blocker(verticalScrollBar());
+        verticalScrollBar()->setRange(0, m_size / m_scale);
+    }
+    void scrolled(int value) {
+        checkSize();
+        if (value == m_lastValue)
+            return;
+        const int delta = value - m_lastValue;
+        if (qAbs(delta) <= verticalScrollBar()->pageStep()) {
+            // arrows, wheel and paging move by whole lines
+            int lines = qMax(1, qRound(qreal(qAbs(delta)) / m_lineStep));
+            while (lines--) {
+                if (delta > 0 && lineEnd(m_top) < m_size)
+                    m_top = lineEnd(m_top);
+                else if (delta < 0 && m_top > 0)
+                    m_top = lineStart(m_top - 1);
+            }
+        } else {
+            m_top = lineStart(qMin(m_size, qint64(value) * m_scale));
+        }
+        m_lastValue = value;
+        if (!verticalScrollBar()->isSliderDown()) {
+            m_lastValue = m_top / m_scale;
+            const QSignalBlocker blocker(verticalScrollBar());
+            verticalScrollBar()->setValue(m_lastValue);
+        }
+        viewport()->update();
     }
-    SHOW_DIALOG
-    return 0;
-}
+    QFile *m_file;
+    const uchar *m_data;
+    qint64 m_mapped, m_size, m_scale, m_lineStep, m_top;
+    int m_lastValue, m_width;
+};
 
 char Qarma::showText(const QStringList &args)
 {
@@ -1220,30 +3223,82 @@ char Qarma::showText(const QStringList &args)
     QCheckBox *cb(NULL);
 
     QString filename;
-    bool html(false), plain(false), onlyMarkup(false), url(false);
+    bool html(false), plain(false), onlyMarkup(false), url(false), paged(false), urlProgress(false);
+    qint64 maxDownload(0);
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--filename") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--filename") {
             filename = NEXT_ARG;
-        } else if (args.at(i) == "--url") {
+            continue;
+        }
+        OPTION("--url") {
             filename = NEXT_ARG;
             url = true;
+            continue;
         }
-        else if (args.at(i) == "--editable")
+        OPTION("--editable") {
             te->setReadOnly(false);
-        else if (args.at(i) == "--font") {
+            continue;
+        }
+        OPTION("--font") {
             te->setFont(QFont(NEXT_ARG));
-        } else if (args.at(i) == "--checkbox") {
+            continue;
+        }
+        OPTION("--checkbox") {
             vl->addWidget(cb = new QCheckBox(NEXT_ARG, dlg));
-        } else if (args.at(i) == "--auto-scroll") {
+            continue;
+        }
+        OPTION("--auto-scroll") {
             te->setProperty("qarma_autoscroll", true);
-        } else if (args.at(i) == "--html") {
+            continue;
+        }
+        OPTION("--html") {
             html = true;
             te->setProperty("qarma_html", true);
-        } else if (args.at(i) == "--plain") {
+            continue;
+        }
+        OPTION("--plain") {
             plain = true;
-        } else if (args.at(i) == "--no-interaction") {
+            continue;
+        }
+        OPTION("--no-interaction") {
             onlyMarkup = true;
-        } else { WARN_UNKNOWN_ARG("--text-info") }
+            continue;
+        }
+        OPTION("--paged") {
+            paged = true;
+            continue;
+        }
+        OPTION("--url-progress") {
+            urlProgress = true;
+            continue;
+        }
+        OPTION("--max-download") {
+            bool ok;
+            maxDownload = NEXT_ARG.toLongLong(&ok);
+            if (!ok || maxDownload < 1)
+                return !error("--max-download must be followed by a positive number");
+            continue;
+        }
+        OPTION("--max-lines") {
+            bool ok;
+            const uint lines = NEXT_ARG.toUInt(&ok);
+            if (!ok)
+                return !error("--max-lines must be followed by a positive number");
+            te->document()->setMaximumBlockCount(qMin<uint>(lines, INT_MAX)); // larger is unbounded anyway
+            continue;
+        }
+        OPTION("--max-chars") {
+            bool ok;
+            const uint chars = NEXT_ARG.toUInt(&ok);
+            if (!ok)
+                return !error("--max-chars must be followed by a positive number");
+            te->setProperty("qarma_max_chars", qMin<uint>(chars, INT_MAX));
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--text-info")
     }
 
     if (html) {
@@ -1265,13 +3320,86 @@ char Qarma::showText(const QStringList &args)
     if (filename.isNull()) {
         listenToStdIn();
     } else if (url) {
-        QProcess *curl = new QProcess;
-        connect(curl, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), [=]() {
-            te->setText(QString::fromLocal8Bit(curl->readAllStandardOutput()));
-            delete curl;
+        // the body is appended as it arrives, like text from stdin
+        QProcess *curl = new QProcess(dlg);
+        QProgressBar *progress(NULL);
+        if (urlProgress) {
+            vl->addWidget(progress = new QProgressBar(dlg));
+            progress->setRange(0, 0); // until curl knows the size
+        }
+        QSharedPointer<QTextDecoder> decoder(QTextCodec::codecForLocale()->makeDecoder());
+        QSharedPointer<QString> pending(new QString);
+        QSharedPointer<qint64> received(new qint64(0));
+        // without --html it's rich text if it looks like it, like setText() decided - but on the
+        // first chunk, the mode can't change while streaming
+        QSharedPointer<bool> detected(new bool(html));
+        auto append = [=](bool flush) {
+            if (!*detected && !pending->isEmpty()) {
+                *detected = true;
+                te->setProperty("qarma_html", Qt::mightBeRichText(*pending));
+            }
+            appendText(te, *pending, flush);
+        };
+        connect(curl, &QProcess::readyReadStandardOutput, dlg, [=]() {
+            QByteArray chunk = curl->readAllStandardOutput();
+            if (maxDownload && *received + chunk.size() >= maxDownload) {
+                chunk.truncate(maxDownload - *received);
+                curl->disconnect(dlg);
+                curl->kill();
+                *received = maxDownload;
+                *pending += decoder->toUnicode(chunk);
+                append(true);
+                if (progress)
+                    progress->hide();
+                return;
+            }
+            *received += chunk.size();
+            *pending += decoder->toUnicode(chunk);
+            append(false);
         });
-        curl->start("curl", QStringList() << "-L" << "-s" << filename);
-    } else {
+        if (progress) {
+            // curl's "-#" meter ends every update with the percentage
+            connect(curl, &QProcess::readyReadStandardError, dlg, [=]() {
+                static const QRegularExpression percent("(\\d+)[.,]\\d%");
+                const QString meter = QString::fromLatin1(curl->readAllStandardError());
+                QRegularExpressionMatchIterator it = percent.globalMatch(meter);
+                QString last;
+                while (it.hasNext())
+                    last = it.next().captured(1);
+                if (!last.isEmpty()) {
+                    progress->setRange(0, 100);
+                    progress->setValue(last.toInt());
+                }
+            });
+        }
+        connect(curl, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), dlg, [=]() {
+            *pending += decoder->toUnicode(curl->readAllStandardOutput());
+            append(true);
+
+            if (progress)
+                progress->hide();
+        });
+        curl->start("curl", QStringList() << "-L" << (urlProgress ? "-#" : "-s") << filename);
+    } else if (QFileInfo(filename).size() > gs_pagedThreshold || paged) {
+        QFile *file = new QFile(filename);
+        const uchar *data = NULL;
+        if (!html && te->isReadOnly() && file->open(QIODevice::ReadOnly) && file->size() > 0)
+            data = file->map(0, file->size());
+        if (data) {
+            MappedTextView *view = new MappedTextView(file, data, dlg);
+            view->setFont(te->font());
+            view->setFrameStyle(te->frameStyle());
+            view->viewport()->setPalette(te->viewport()->palette());
+            view->viewport()->setAutoFillBackground(te->viewport()->autoFillBackground());
+            delete vl->replaceWidget(te, view);
+            delete te;
+            paged = true;
+        } else {
+            delete file;
+            paged = false;
+        }
+    }
+    if (!paged && !url && !filename.isNull()) {
         QFile file(filename);
         if (file.open(QIODevice::ReadOnly)) {
             if (html)
@@ -1296,27 +3424,25 @@ char Qarma::showText(const QStringList &args)
     return 0;
 }
 
-static QStringList splitSkipEmptyParts(const QString& str, const QRegularExpression& sep) {
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-	return str.split(sep, Qt::SkipEmptyParts);
-#else
-	return str.split(sep, QString::SkipEmptyParts);
-#endif
-}
-
 char Qarma::showColorSelection(const QStringList &args)
 {
     QColorDialog *dlg = new QColorDialog;
     QVariantList l = QSettings("qarma").value("CustomPalette").toList();
     for (int i = 0; i < l.count() && i < dlg->customCount(); ++i)
         dlg->setCustomColor(i, QColor(l.at(i).toUInt()));
+    StartupTrace::mark("settings");
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--color") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--color") {
             dlg->setCurrentColor(QColor(NEXT_ARG));
-        } else if (args.at(i) == "--show-palette") {
+            continue;
+        }
+        OPTION("--show-palette") {
             qWarning("The show-palette parameter is not supported by qarma. Sorry.");
             void(0);
-        } else if (args.at(i) == "--custom-palette") {
+            continue;
+        }
+        OPTION("--custom-palette") {
             if (i+1 < args.count()) {
                 QString path = NEXT_ARG;
                 QFile file(path);
@@ -1342,7 +3468,11 @@ char Qarma::showColorSelection(const QStringList &args)
             } else {
                 qWarning("You have to provide a gimp palette (*.gpl)");
             }
-        }{ WARN_UNKNOWN_ARG("--color-selection") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--color-selection")
     }
     SHOW_DIALOG
     return 0;
@@ -1354,7 +3484,8 @@ char Qarma::showFontSelection(const QStringList &args)
     QString pattern = "%1-%2:%3:%4";
     QString sample = "The quick brown fox jumps over the lazy dog";
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--type") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--type") {
             QStringList types = NEXT_ARG.split(',');
             QFontDialog::FontDialogOptions opts;
             for (const QString &type : types) {
@@ -1366,13 +3497,21 @@ char Qarma::showFontSelection(const QStringList &args)
             if (opts) // https://bugreports.qt.io/browse/QTBUG-93473
                 dlg->setOptions(opts);
             dlg->setCurrentFont(QFont()); // also works around the bug :P
-        } else if (args.at(i) == "--pattern") {
+            continue;
+        }
+        OPTION("--pattern") {
             pattern = NEXT_ARG;
             if (!pattern.contains("%1"))
                 qWarning("The output pattern doesn't include a placeholder for the font name...");
-        } else if (args.at(i) == "--sample") {
+            continue;
+        }
+        OPTION("--sample") {
             sample = NEXT_ARG;
-        } { WARN_UNKNOWN_ARG("--font-selection") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--font-selection")
     }
     if (QLineEdit *smpl = dlg->findChild<QLineEdit*>("qt_fontDialog_sampleEdit"))
         smpl->setText(sample);
@@ -1398,6 +3537,8 @@ static void buildList(QTreeWidget **tree, QStringList &values, QStringList &colu
     }
 
 
+    TextWidths widths;
+    widths.add(values, 0, columnCount, tw->fontMetrics(), false);
     for (int i = 0; i < values.count(); ) {
         QStringList itemValues;
         for (int j = 0; j < columnCount; ++j) {
@@ -1408,8 +3549,7 @@ static void buildList(QTreeWidget **tree, QStringList &values, QStringList &colu
         tw->addTopLevelItem(new QTreeWidgetItem(tw, itemValues));
     }
 
-    for (int i = 0; i < columns.count(); ++i)
-        tw->resizeColumnToContents(i);
+    fitColumns(tw, widths, columns.count(), 0);
 
     values.clear();
     columns.clear();
@@ -1436,43 +3576,72 @@ char Qarma::showForms(const QStringList &args)
     bool lastListHeader(false);
     QComboBox *lastCombo = NULL;
     for (int i = 0; i < args.count(); ++i) {
-        if (args.at(i) == "--add-entry") {
+        switch (optionHash(args.at(i))) {
+        OPTION("--add-entry") {
             fl->addRow(NEXT_ARG, new QLineEdit(dlg));
-        } else if (args.at(i) == "--add-password") {
+            continue;
+        }
+        OPTION("--add-password") {
             QLineEdit *le;
             fl->addRow(NEXT_ARG, le = new QLineEdit(dlg));
             le->setEchoMode(QLineEdit::Password);
-        } else if (args.at(i) == "--add-calendar") {
+            continue;
+        }
+        OPTION("--add-calendar") {
             fl->addRow(NEXT_ARG, new QCalendarWidget(dlg));
-        } else if (args.at(i) == "--add-list") {
+            continue;
+        }
+        OPTION("--add-list") {
             buildList(&lastList, lastListValues, lastListColumns, lastListHeader);
             fl->addRow(NEXT_ARG, lastList = new QTreeWidget(dlg));
-        } else if (args.at(i) == "--list-values") {
+            continue;
+        }
+        OPTION("--list-values") {
             lastListValues = NEXT_ARG.split('|');
-        } else if (args.at(i) == "--column-values") {
+            continue;
+        }
+        OPTION("--column-values") {
             lastListColumns = NEXT_ARG.split('|');
-        } else if (args.at(i) == "--add-combo") {
+            continue;
+        }
+        OPTION("--add-combo") {
             fl->addRow(NEXT_ARG, lastCombo = new QComboBox(dlg));
             lastCombo->addItems(lastComboValues);
             lastComboValues.clear();
-        } else if (args.at(i) == "--combo-values") {
+            continue;
+        }
+        OPTION("--combo-values") {
             lastComboValues = NEXT_ARG.split('|');
             if (lastCombo) {
                 lastCombo->addItems(lastComboValues);
                 lastComboValues.clear();
                 lastCombo = NULL;
             }
-        } else if (args.at(i) == "--show-header") {
+            continue;
+        }
+        OPTION("--show-header") {
             lastListHeader = true;
-        } else if (args.at(i) == "--text") {
+            continue;
+        }
+        OPTION("--text") {
             label->setText(labelText(NEXT_ARG));
-        } else if (args.at(i) == "--separator") {
+            continue;
+        }
+        OPTION("--separator") {
             dlg->setProperty("qarma_separator", NEXT_ARG);
-        } else if (args.at(i) == "--forms-date-format") {
+            continue;
+        }
+        OPTION("--forms-date-format") {
             dlg->setProperty("qarma_date_format", NEXT_ARG);
-        } else if (args.at(i) == "--add-checkbox") {
+            continue;
+        }
+        OPTION("--add-checkbox") {
             fl->addRow(new QCheckBox(NEXT_ARG, dlg));
-        } else { WARN_UNKNOWN_ARG("--forms") }
+            continue;
+        }
+        default: break;
+        }
+        WARN_UNKNOWN_ARG("--forms")
     }
     buildList(&lastList, lastListValues, lastListColumns, lastListHeader);
 
@@ -1482,267 +3651,843 @@ char Qarma::showForms(const QStringList &args)
     return 0;
 }
 
+// zenity uses pango markup, https://developer.gnome.org/pygtk/stable/pango-markup-language.html
+// This near-html-subset isn't really compatible w/ Qt's html subset and we end up
+// w/ a weird mix of ASCII escape codes and html tags
+// the below is NOT a perfect translation
+
+// known "caveats"
+// pango termiantes the string for "\0" (we do not - atm)
+// pango inserts some control char for "\f", but that's not reasonably handled by gtk label (so it's ignored here)
+
+// One pass over the escapes, with the very results of the former chain of replacements:
+// "\\" is a backslash, "\n" and "\r" break the line, "\t" is three &nbsp;, "\NNN" is an octal
+// character and any other backslash is dropped. BEL was the placeholder for escaped backslashes,
+// so it ends up as one - as does a decoded BEL. A decoded backslash starts a new octal escape
+// if a digit follows and is dropped otherwise.
+static QString zenityLabelText(const QString &s)
+{
+    if (s.indexOf('\\') < 0 && s.indexOf('\a') < 0)
+        return s;
+    QString r;
+    r.reserve(s.size() + 32);
+    const QChar *c = s.constData(), *end = c + s.size();
+    while (c < end) {
+        if (*c == '\a') {
+            r += '\\';
+            ++c;
+            continue;
+        }
+        if (*c != '\\') {
+            const QChar *run = c;
+            while (c < end && *c != '\\' && *c != '\a')
+                ++c;
+            r.append(run, c - run);
+            continue;
+        }
+        if (++c == end)
+            break;
+        const ushort e = c->unicode();
+        if (e == '\\') {
+            r += '\\';
+        } else if (e == 'n' || e == 'r') {
+            r += QLatin1String("<br>");
+        } else if (e == 't') {
+            r += QLatin1String("&nbsp;&nbsp;&nbsp;");
+        } else if (e >= '0' && e <= '9') {
+            QChar decoded('\\');
+            while (decoded == '\\' && c < end && c->unicode() >= '0' && c->unicode() <= '9') {
+                // up to three digits of any script, but only ASCII octal ones make a number
+                uint code = 0;
+                bool octal = true;
+                for (int n = 0; n < 3 && c < end && c->isDigit(); ++n, ++c) {
+                    octal = octal && c->unicode() >= '0' && c->unicode() <= '7';
+                    code = code * 8 + (c->unicode() - '0');
+                }
+                decoded = QChar(octal ? code : 0); // like QString::toUInt(.., 8)
+            }
+            if (decoded == '\a')
+                r += '\\';
+            else if (decoded != '\\')
+                r += decoded;
+            continue;
+        } else {
+            continue; // unknown escape, keep the character
+        }
+        ++c;
+    }
+    return r;
+}
+
 QString Qarma::labelText(const QString &s) const
 {
-    // zenity uses pango markup, https://developer.gnome.org/pygtk/stable/pango-markup-language.html
-    // This near-html-subset isn't really compatible w/ Qt's html subset and we end up
-    // w/ a weird mix of ASCII escape codes and html tags
-    // the below is NOT a perfect translation
-
-    // known "caveats"
-    // pango termiantes the string for "\0" (we do not - atm)
-    // pango inserts some control char for "\f", but that's not reasonably handled by gtk label (so it's ignored here)
-    if (m_zenity) {
-        QString r = s;
-        // First replace backslashes with alarms to avoid false positives below.
-        // The alarm is treated as invalid and not supported by zenity/pango either
-        r.replace("\\\\", "\a") \
-         .replace("\\n", "<br>").replace("\\t", "&nbsp;&nbsp;&nbsp;") \
-         .replace("\\r", "<br>");
-        int idx = 0;
-        while (true) {
-            idx = r.indexOf(QRegExp("\\\\([0-9]{1,3})"), idx);
-            if (idx < 0)
+    return m_zenity ? zenityLabelText(s) : s;
+}
+
+
+// The help is static data, only the printed category gets translated.
+// Categories are sorted by name, that's the order of --help-all
+struct HelpEntry { const char *option, *prefix, *text; };
+struct HelpCategory { const char *name, *title; const HelpEntry *entries; int count; };
+#define HELP_CATEGORY(_NAME_, _TITLE_, _ENTRIES_) { _NAME_, QT_TRANSLATE_NOOP("Qarma", _TITLE_), _ENTRIES_, int(sizeof(_ENTRIES_)/sizeof(*_ENTRIES_)) }
+
+static constexpr HelpEntry gs_helpHelp[] = {
+    {"-h, --help", "", QT_TRANSLATE_NOOP("Qarma", "Show help options")},
+    {"--help-all", "", QT_TRANSLATE_NOOP("Qarma", "Show all help options")},
+    {"--help-general", "", QT_TRANSLATE_NOOP("Qarma", "Show general options")},
+    {"--help-calendar", "", QT_TRANSLATE_NOOP("Qarma", "Show calendar options")},
+    {"--help-entry", "", QT_TRANSLATE_NOOP("Qarma", "Show text entry options")},
+    {"--help-error", "", QT_TRANSLATE_NOOP("Qarma", "Show error options")},
+    {"--help-info", "", QT_TRANSLATE_NOOP("Qarma", "Show info options")},
+    {"--help-file-selection", "", QT_TRANSLATE_NOOP("Qarma", "Show file selection options")},
+    {"--help-list", "", QT_TRANSLATE_NOOP("Qarma", "Show list options")},
+    {"--help-notification", "", QT_TRANSLATE_NOOP("Qarma", "Show notification icon options")},
+    {"--help-progress", "", QT_TRANSLATE_NOOP("Qarma", "Show progress options")},
+    {"--help-question", "", QT_TRANSLATE_NOOP("Qarma", "Show question options")},
+    {"--help-warning", "", QT_TRANSLATE_NOOP("Qarma", "Show warning options")},
+    {"--help-scale", "", QT_TRANSLATE_NOOP("Qarma", "Show scale options")},
+    {"--help-text-info", "", QT_TRANSLATE_NOOP("Qarma", "Show text information options")},
+    {"--help-color-selection", "", QT_TRANSLATE_NOOP("Qarma", "Show color selection options")},
+    {"--help-password", "", QT_TRANSLATE_NOOP("Qarma", "Show password dialog options")},
+    {"--help-forms", "", QT_TRANSLATE_NOOP("Qarma", "Show forms dialog options")},
+    {"--help-misc", "", QT_TRANSLATE_NOOP("Qarma", "Show miscellaneous options")},
+    {"--help-qt", "", QT_TRANSLATE_NOOP("Qarma", "Show Qt Options")},
+};
+
+static constexpr HelpEntry gs_helpGeneral[] = {
+    {"--title=TITLE", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog title")},
+    {"--window-icon=ICONPATH", "", QT_TRANSLATE_NOOP("Qarma", "Set the window icon")},
+    {"--width=WIDTH", "", QT_TRANSLATE_NOOP("Qarma", "Set the width")},
+    {"--height=HEIGHT", "", QT_TRANSLATE_NOOP("Qarma", "Set the height")},
+    {"--timeout=TIMEOUT", "", QT_TRANSLATE_NOOP("Qarma", "Set dialog timeout in seconds")},
+    {"--ok-label=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Sets the label of the Ok button")},
+    {"--cancel-label=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Sets the label of the Cancel button")},
+    {"--modal", "", QT_TRANSLATE_NOOP("Qarma", "Set the modal hint")},
+    {"--attach=WINDOW", "", QT_TRANSLATE_NOOP("Qarma", "Set the parent window to attach to")},
+    {"--output-format=FORMAT", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Print list, file and forms results as json, nul (terminated records) or tsv")},
+};
+
+static constexpr HelpEntry gs_helpCalendar[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--day=DAY", "", QT_TRANSLATE_NOOP("Qarma", "Set the calendar day")},
+    {"--month=MONTH", "", QT_TRANSLATE_NOOP("Qarma", "Set the calendar month")},
+    {"--year=YEAR", "", QT_TRANSLATE_NOOP("Qarma", "Set the calendar year")},
+    {"--timeout=TIMEOUT", "", QT_TRANSLATE_NOOP("Qarma", "Set dialog timeout in seconds")},
+    {"--date-format=PATTERN", "", QT_TRANSLATE_NOOP("Qarma", "Set the format for the returned date")},
+};
+
+static constexpr HelpEntry gs_helpEntry[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--entry-text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the entry text")},
+    {"--hide-text", "", QT_TRANSLATE_NOOP("Qarma", "Hide the entry text")},
+    {"--values=v1|v2|v3|...", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Offer preset values to pick from")},
+    {"--int=integer", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Integer input only, preset given value")},
+    {"--float=floating_point", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Floating point input only, preset given value")},
+};
+
+static constexpr HelpEntry gs_helpError[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--icon-name=ICON-NAME", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog icon")},
+    {"--no-wrap", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable text wrapping")},
+    {"--no-markup", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable html markup")},
+    {"--ellipsize", "", QT_TRANSLATE_NOOP("Qarma", "Do wrap text, zenity has a rather special problem here")},
+    {"--selectable-labels", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Allow to select text for copy and paste")},
+};
+
+static constexpr HelpEntry gs_helpInfo[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--icon-name=ICON-NAME", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog icon")},
+    {"--no-wrap", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable text wrapping")},
+    {"--no-markup", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable html markup")},
+    {"--ellipsize", "", QT_TRANSLATE_NOOP("Qarma", "Do wrap text, zenity has a rather special problem here")},
+    {"--selectable-labels", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Allow to select text for copy and paste")},
+};
+
+static constexpr HelpEntry gs_helpFileSelection[] = {
+    {"--filename=FILENAME", "", QT_TRANSLATE_NOOP("Qarma", "Set the filename")},
+    {"--multiple", "", QT_TRANSLATE_NOOP("Qarma", "Allow multiple files to be selected")},
+    {"--directory", "", QT_TRANSLATE_NOOP("Qarma", "Activate directory-only selection")},
+    {"--save", "", QT_TRANSLATE_NOOP("Qarma", "Activate save mode")},
+    {"--separator=SEPARATOR", "", QT_TRANSLATE_NOOP("Qarma", "Set output separator character")},
+    {"--confirm-overwrite", "", QT_TRANSLATE_NOOP("Qarma", "Confirm file selection if filename already exists")},
+    {"--file-filter=NAME | PATTERN1 PATTERN2 ...", "", QT_TRANSLATE_NOOP("Qarma", "Sets a filename filter")},
+    {"--async-listing", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Use a file picker that lists directories in the background and caches the listings")},
+};
+
+static constexpr HelpEntry gs_helpList[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--column=COLUMN", "", QT_TRANSLATE_NOOP("Qarma", "Set the column header")},
+    {"--column=COLUMN:TYPE", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Sort the column as text, numeric, date or size")},
+    {"--checklist", "", QT_TRANSLATE_NOOP("Qarma", "Use check boxes for first column")},
+    {"--radiolist", "", QT_TRANSLATE_NOOP("Qarma", "Use radio buttons for first column")},
+    {"--imagelist", "", QT_TRANSLATE_NOOP("Qarma", "Use an image for first column")},
+    {"--separator=SEPARATOR", "", QT_TRANSLATE_NOOP("Qarma", "Set output separator character")},
+    {"--multiple", "", QT_TRANSLATE_NOOP("Qarma", "Allow multiple rows to be selected")},
+    {"--editable", "", QT_TRANSLATE_NOOP("Qarma", "Allow changes to text")},
+    {"--print-column=NUMBER", "", QT_TRANSLATE_NOOP("Qarma", "Print a specific column (Default is 1. 'ALL' can be used to print all columns)")},
+    {"--print-column=N,M", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Print several columns")},
+    {"--hide-column=NUMBER", "", QT_TRANSLATE_NOOP("Qarma", "Hide a specific column")},
+    {"--hide-header", "", QT_TRANSLATE_NOOP("Qarma", "Hides the column headers")},
+    {"--mid-search", "", QT_TRANSLATE_NOOP("Qarma", "Change list default search function searching for text in the middle, not on the beginning")},
+};
+
+static constexpr HelpEntry gs_helpNotification[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--listen", "", QT_TRANSLATE_NOOP("Qarma", "Listen for commands on stdin")},
+    {"--hint=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the notification hints")},
+    {"--selectable-labels", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Allow to select text for copy and paste")},
+};
+
+static constexpr HelpEntry gs_helpProgress[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--percentage=PERCENTAGE", "", QT_TRANSLATE_NOOP("Qarma", "Set initial percentage")},
+    {"--pulsate", "", QT_TRANSLATE_NOOP("Qarma", "Pulsate progress bar")},
+    {"--auto-close", "", QT_TRANSLATE_NOOP("Qarma", "Dismiss the dialog when 100% has been reached")},
+    {"--auto-kill", "", QT_TRANSLATE_NOOP("Qarma", "Kill parent process if Cancel button is pressed")},
+    {"--no-cancel", "", QT_TRANSLATE_NOOP("Qarma", "Hide Cancel button")},
+    {"--update-interval=MS", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Apply stdin updates at most once per interval (default: 16)")},
+};
+
+static constexpr HelpEntry gs_helpQuestion[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--icon-name=ICON-NAME", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog icon")},
+    {"--no-wrap", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable text wrapping")},
+    {"--no-markup", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable html markup")},
+    {"--default-cancel", "", QT_TRANSLATE_NOOP("Qarma", "Give cancel button focus by default")},
+    {"--ellipsize", "", QT_TRANSLATE_NOOP("Qarma", "Do wrap text, zenity has a rather special problem here")},
+    {"--selectable-labels", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Allow to select text for copy and paste")},
+};
+
+static constexpr HelpEntry gs_helpWarning[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--icon-name=ICON-NAME", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog icon")},
+    {"--no-wrap", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable text wrapping")},
+    {"--no-markup", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable html markup")},
+    {"--ellipsize", "", QT_TRANSLATE_NOOP("Qarma", "Do wrap text, zenity has a rather special problem here")},
+    {"--selectable-labels", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Allow to select text for copy and paste")},
+};
+
+static constexpr HelpEntry gs_helpScale[] = {
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--value=VALUE", "", QT_TRANSLATE_NOOP("Qarma", "Set initial value")},
+    {"--min-value=VALUE", "", QT_TRANSLATE_NOOP("Qarma", "Set minimum value")},
+    {"--max-value=VALUE", "", QT_TRANSLATE_NOOP("Qarma", "Set maximum value")},
+    {"--step=VALUE", "", QT_TRANSLATE_NOOP("Qarma", "Set step size")},
+    {"--print-partial", "", QT_TRANSLATE_NOOP("Qarma", "Print partial values")},
+    {"--hide-value", "", QT_TRANSLATE_NOOP("Qarma", "Hide value")},
+};
+
+static constexpr HelpEntry gs_helpTextInfo[] = {
+    {"--filename=FILENAME", "", QT_TRANSLATE_NOOP("Qarma", "Open file")},
+    {"--editable", "", QT_TRANSLATE_NOOP("Qarma", "Allow changes to text")},
+    {"--font=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the text font")},
+    {"--checkbox=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Enable an I read and agree checkbox")},
+    {"--plain", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Force plain text, zenity default limitation")},
+    {"--html", "", QT_TRANSLATE_NOOP("Qarma", "Enable HTML support")},
+    {"--no-interaction", "", QT_TRANSLATE_NOOP("Qarma", "Do not enable user interaction with the WebView. Only works if you use --html option")},
+    {"--url=URL", "REQUIRES CURL BINARY! ", QT_TRANSLATE_NOOP("Qarma", "Set an URL instead of a file. Only works if you use --html option")},
+    {"--url-progress", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Show the download progress of --url")},
+    {"--max-download=BYTES", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Stop reading --url after this many bytes")},
+    {"--auto-scroll", "", QT_TRANSLATE_NOOP("Qarma", "Auto scroll the text to the end. Only when text is captured from stdin")},
+    {"--paged", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Map the file and only render the visible part, lines are not wrapped. Implied for plain text files beyond 16 MiB")},
+    {"--max-lines=LINES", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Drop the oldest lines beyond this count")},
+    {"--max-chars=COUNT", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Drop the oldest lines beyond this many characters. Only when text is captured from stdin")},
+};
+
+static constexpr HelpEntry gs_helpColorSelection[] = {
+    {"--color=VALUE", "", QT_TRANSLATE_NOOP("Qarma", "Set the color")},
+    {"--show-palette", "", QT_TRANSLATE_NOOP("Qarma", "Show the palette")},
+    {"--custom-palette=path/to/some.gpl", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Load a custom GPL for standard colors")},
+};
+
+static constexpr HelpEntry gs_helpFontSelection[] = {
+    {"--type=[vector][,bitmap][,fixed][,variable]", "", QT_TRANSLATE_NOOP("Qarma", "Filter fonts (default: all)")},
+    {"--pattern=%1-%2:%3:%4", "", QT_TRANSLATE_NOOP("Qarma", "Output pattern, %1: Name, %2: Size, %3: weight, %4: slant")},
+    {"--sample=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Sample text, defaults to the foxdogthing")},
+};
+
+static constexpr HelpEntry gs_helpPassword[] = {
+    {"--username", "", QT_TRANSLATE_NOOP("Qarma", "Display the username option")},
+    {"--prompt=TEXT", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "The prompt for the user")},
+};
+
+static constexpr HelpEntry gs_helpForms[] = {
+    {"--add-entry=Field name", "", QT_TRANSLATE_NOOP("Qarma", "Add a new Entry in forms dialog")},
+    {"--add-password=Field name", "", QT_TRANSLATE_NOOP("Qarma", "Add a new Password Entry in forms dialog")},
+    {"--add-calendar=Calendar field name", "", QT_TRANSLATE_NOOP("Qarma", "Add a new Calendar in forms dialog")},
+    {"--add-list=List field and header name", "", QT_TRANSLATE_NOOP("Qarma", "Add a new List in forms dialog")},
+    {"--list-values=List of values separated by |", "", QT_TRANSLATE_NOOP("Qarma", "List of values for List")},
+    {"--column-values=List of values separated by |", "", QT_TRANSLATE_NOOP("Qarma", "List of values for columns")},
+    {"--add-combo=Combo box field name", "", QT_TRANSLATE_NOOP("Qarma", "Add a new combo box in forms dialog")},
+    {"--combo-values=List of values separated by |", "", QT_TRANSLATE_NOOP("Qarma", "List of values for combo box")},
+    {"--show-header", "", QT_TRANSLATE_NOOP("Qarma", "Show the columns header")},
+    {"--text=TEXT", "", QT_TRANSLATE_NOOP("Qarma", "Set the dialog text")},
+    {"--separator=SEPARATOR", "", QT_TRANSLATE_NOOP("Qarma", "Set output separator character")},
+    {"--forms-date-format=PATTERN", "", QT_TRANSLATE_NOOP("Qarma", "Set the format for the returned date")},
+    {"--add-checkbox=Checkbox label", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Add a new Checkbox forms dialog")},
+};
+
+static constexpr HelpEntry gs_helpMisc[] = {
+    {"--about", "", QT_TRANSLATE_NOOP("Qarma", "About Qarma")},
+    {"--version", "", QT_TRANSLATE_NOOP("Qarma", "Print version")},
+    {"--daemon", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Keep warm instances around to serve subsequent calls")},
+    {"--args-from=FILE", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Read further NUL terminated arguments from FILE, - is stdin")},
+    {"--args-netstrings", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "--args-from reads length prefixed \"<length>:<bytes>,\" arguments")},
+    {"--check", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Only validate the arguments, without showing anything")},
+};
+
+static constexpr HelpEntry gs_helpQt[] = {
+    {"--foo", "", QT_TRANSLATE_NOOP("Qarma", "Foo")},
+    {"--bar", "", QT_TRANSLATE_NOOP("Qarma", "Bar")},
+};
+
+static constexpr HelpEntry gs_helpApplication[] = {
+    {"--calendar", "", QT_TRANSLATE_NOOP("Qarma", "Display calendar dialog")},
+    {"--entry", "", QT_TRANSLATE_NOOP("Qarma", "Display text entry dialog")},
+    {"--error", "", QT_TRANSLATE_NOOP("Qarma", "Display error dialog")},
+    {"--info", "", QT_TRANSLATE_NOOP("Qarma", "Display info dialog")},
+    {"--file-selection", "", QT_TRANSLATE_NOOP("Qarma", "Display file selection dialog")},
+    {"--list", "", QT_TRANSLATE_NOOP("Qarma", "Display list dialog")},
+    {"--notification", "", QT_TRANSLATE_NOOP("Qarma", "Display notification")},
+    {"--progress", "", QT_TRANSLATE_NOOP("Qarma", "Display progress indication dialog")},
+    {"--question", "", QT_TRANSLATE_NOOP("Qarma", "Display question dialog")},
+    {"--warning", "", QT_TRANSLATE_NOOP("Qarma", "Display warning dialog")},
+    {"--scale", "", QT_TRANSLATE_NOOP("Qarma", "Display scale dialog")},
+    {"--text-info", "", QT_TRANSLATE_NOOP("Qarma", "Display text information dialog")},
+    {"--color-selection", "", QT_TRANSLATE_NOOP("Qarma", "Display color selection dialog")},
+    {"--font-selection", "QARMA ONLY! ", QT_TRANSLATE_NOOP("Qarma", "Display font selection dialog")},
+    {"--password", "", QT_TRANSLATE_NOOP("Qarma", "Display password dialog")},
+    {"--forms", "", QT_TRANSLATE_NOOP("Qarma", "Display forms dialog")},
+    {"--display=DISPLAY", "", QT_TRANSLATE_NOOP("Qarma", "X display to use")},
+};
+
+static constexpr HelpCategory gs_helpCategories[] = {
+    HELP_CATEGORY("application", "Application Options", gs_helpApplication),
+    HELP_CATEGORY("calendar", "Calendar options", gs_helpCalendar),
+    HELP_CATEGORY("color-selection", "Color selection options", gs_helpColorSelection),
+    HELP_CATEGORY("entry", "Text entry options", gs_helpEntry),
+    HELP_CATEGORY("error", "Error options", gs_helpError),
+    HELP_CATEGORY("file-selection", "File selection options", gs_helpFileSelection),
+    HELP_CATEGORY("font-selection", "Font selection options", gs_helpFontSelection),
+    HELP_CATEGORY("forms", "Forms dialog options", gs_helpForms),
+    HELP_CATEGORY("general", "General options", gs_helpGeneral),
+    HELP_CATEGORY("help", "Help options", gs_helpHelp),
+    HELP_CATEGORY("info", "Info options", gs_helpInfo),
+    HELP_CATEGORY("list", "List options", gs_helpList),
+    HELP_CATEGORY("misc", "Miscellaneous options", gs_helpMisc),
+    HELP_CATEGORY("notification", "Notification icon options", gs_helpNotification),
+    HELP_CATEGORY("password", "Password dialog options", gs_helpPassword),
+    HELP_CATEGORY("progress", "Progress options", gs_helpProgress),
+    HELP_CATEGORY("qt", "Qt options", gs_helpQt),
+    HELP_CATEGORY("question", "Question options", gs_helpQuestion),
+    HELP_CATEGORY("scale", "Scale options", gs_helpScale),
+    HELP_CATEGORY("text-info", "Text information options", gs_helpTextInfo),
+    HELP_CATEGORY("warning", "Warning options", gs_helpWarning),
+};
+
+static void printCategory(const HelpCategory &help)
+{
+    printf("%s\n", qPrintable(Qarma::tr(help.title)));
+    for (int i = 0; i < help.count; ++i) {
+        const HelpEntry &entry = help.entries[i];
+        printf("  %-53s%s\n", entry.option, qPrintable(entry.prefix + Qarma::tr(entry.text)));
+    }
+    printf("\n");
+}
+
+void Qarma::printHelp(const QString &category)
+{
+    if (category == "all") {
+        for (const HelpCategory &help : gs_helpCategories)
+            printCategory(help);
+        return;
+    }
+
+    if (!category.isEmpty()) {
+        const QByteArray name = category.toLatin1();
+        for (const HelpCategory &help : gs_helpCategories) {
+            if (name == help.name) {
+                printCategory(help);
+                return;
+            }
+        }
+    }
+
+    printf("Usage:\n  %s [OPTION ...]\n\n", qPrintable(applicationName()));
+    printHelp("help");
+    printHelp("application");
+}
+
+// --check validates the command line without a QApplication, so neither the display server
+// nor D-Bus is touched. Unknown options are only reported, like the dialogs do.
+static const struct { const char *option; bool base0, positive; } gs_numericOptions[] = {
+    {"--width", false, false}, {"--height", false, false}, {"--timeout", false, false}, {"--attach", true, false},
+    {"--day", false, false}, {"--month", false, false}, {"--year", false, false}, {"--update-interval", false, false},
+    {"--max-download", false, true}, {"--max-lines", false, false}, {"--max-chars", false, false}
+};
+
+static const HelpCategory *helpCategory(const QString &name)
+{
+    const QByteArray latin1 = name.toLatin1();
+    for (const HelpCategory &help : gs_helpCategories) {
+        if (latin1 == help.name)
+            return &help;
+    }
+    return NULL;
+}
+
+static int checkArguments(int argc, char **argv)
+{
+    QStringList argList, args;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--check"))
+            argList << QString::fromLocal8Bit(argv[i]);
+    }
+    QString unreadable;
+    if (!canonicalArgs(argList, args, unreadable)) {
+        printf("Error: %s", qPrintable("--args-from could not read " + unreadable));
+        return 1;
+    }
+
+    // the first dialog option decides which options are known, their help tells which take a value
+    const HelpCategory *dialog = NULL;
+    const HelpCategory *application = helpCategory("application");
+    for (int i = 0; i < args.count() && !dialog; ++i) {
+        for (int j = 0; j < application->count && !dialog; ++j) {
+            if (args.at(i) == application->entries[j].option)
+                dialog = helpCategory(args.at(i).mid(2));
+        }
+    }
+    if (!dialog) {
+        printf("Error: %s", "no dialog type given");
+        return 1;
+    }
+    QHash<QString, bool> known; // option -> takes a value
+    const HelpCategory *categories[] = { dialog, helpCategory("general"), helpCategory("misc"), application };
+    for (const HelpCategory *help : categories) {
+        for (int j = 0; j < help->count; ++j) {
+            const QString option = QString::fromLatin1(help->entries[j].option);
+            const int value = option.indexOf('=');
+            known.insert(option.left(value), value > -1);
+        }
+    }
+
+    // values are only checked for options the dialog knows, the others are ignored by the real run
+    for (int i = 0; i < args.count(); ++i) {
+        if (!args.at(i).startsWith("--"))
+            continue;
+        if (!known.contains(args.at(i))) {
+            qDebug() << "unspecific argument" << args.at(i);
+            continue;
+        }
+        for (const auto &numeric : gs_numericOptions) {
+            if (args.at(i) == numeric.option) {
+                bool ok;
+                const QString value = args.value(i + 1); // skipped along with the option below
+                const qint64 v = value.toLongLong(&ok, numeric.base0 ? 0 : 10);
+                if (!ok || v < (numeric.positive ? 1 : 0) || v > UINT_MAX) {
+                    printf("Error: %s must be followed by a positive number", numeric.option);
+                    return 1;
+                }
                 break;
-            int sz = 0;
-            while (sz < 3 && r.at(idx+sz+1).isDigit())
-                ++sz;
-            r.replace(idx, sz+1, QChar(r.midRef(idx+1, sz).toUInt(nullptr, 8)));
+            }
+        }
+        if (args.at(i) == "--output-format" && !outputFormat(args.value(i + 1))) {
+            printf("Error: %s", "--output-format must be followed by json, nul or tsv");
+            return 1;
+        }
+        bool all;
+        QVariantList columns;
+        if (args.at(i) == "--print-column" && !parsePrintColumn(args.value(i + 1), &all, &columns)) {
+            printf("Error: %s", "--print-column must be followed by ALL or a comma separated list of column numbers");
+            return 1;
         }
-        r.remove("\\").replace(("\a"), "\\");
-        return r;
+        if (known.value(args.at(i)))
+            ++i;
     }
-    return s;
+    return 0;
 }
 
+#ifdef Q_OS_UNIX
+// --daemon keeps a pre-initialized ("warm") instance around, every further qarma call hands
+// its cwd, argv and stdio descriptors over a unix socket to that instance and waits for the
+// exit code. The warm instance runs the dialog on the callers descriptors and is replaced
+// by a fresh one right after it has been claimed.
 
-void Qarma::printHelp(const QString &category)
+// Whoever listens on the socket gets the callers stdio, so it has to live in a directory
+// nobody else can enter. There's no fallback: without one, qarma runs standalone.
+static QByteArray daemonSocketPath()
+{
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    struct stat info;
+    if (!dir || *dir != '/' || lstat(dir, &info) || !S_ISDIR(info.st_mode) ||
+        info.st_uid != getuid() || (info.st_mode & 077))
+        return QByteArray();
+    return QByteArray(dir) + "/qarma-" + QByteArray::number(getuid()) + ".socket";
+}
+
+static bool peerIsUs(int sock)
+{
+#ifdef SO_PEERCRED
+    ucred cred;
+    socklen_t size = sizeof(cred);
+    return !getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &size) && cred.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return !getpeereid(sock, &uid, &gid) && uid == getuid();
+#endif
+}
+
+static bool writeFully(int fd, const char *data, qint64 size)
+{
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool readFully(int fd, char *data, qint64 size)
 {
-    static HelpDict helpDict;
-    if (helpDict.isEmpty()) {
-        helpDict["help"] = CategoryHelp(tr("Help options"), HelpList() <<
-                            Help("-h, --help", tr("Show help options")) <<
-                            Help("--help-all", tr("Show all help options")) <<
-                            Help("--help-general", tr("Show general options")) <<
-                            Help("--help-calendar", tr("Show calendar options")) <<
-                            Help("--help-entry", tr("Show text entry options")) <<
-                            Help("--help-error", tr("Show error options")) <<
-                            Help("--help-info", tr("Show info options")) <<
-                            Help("--help-file-selection", tr("Show file selection options")) <<
-                            Help("--help-list", tr("Show list options")) <<
-                            Help("--help-notification", tr("Show notification icon options")) <<
-                            Help("--help-progress", tr("Show progress options")) <<
-                            Help("--help-question", tr("Show question options")) <<
-                            Help("--help-warning", tr("Show warning options")) <<
-                            Help("--help-scale", tr("Show scale options")) <<
-                            Help("--help-text-info", tr("Show text information options")) <<
-                            Help("--help-color-selection", tr("Show color selection options")) <<
-                            Help("--help-password", tr("Show password dialog options")) <<
-                            Help("--help-forms", tr("Show forms dialog options")) <<
-                            Help("--help-misc", tr("Show miscellaneous options")) <<
-                            Help("--help-qt", tr("Show Qt Options")));
-        helpDict["general"] = CategoryHelp(tr("General options"), HelpList() <<
-                            Help("--title=TITLE", tr("Set the dialog title")) <<
-                            Help("--window-icon=ICONPATH", tr("Set the window icon")) <<
-                            Help("--width=WIDTH", tr("Set the width")) <<
-                            Help("--height=HEIGHT", tr("Set the height")) <<
-                            Help("--timeout=TIMEOUT", tr("Set dialog timeout in seconds")) <<
-                            Help("--ok-label=TEXT", tr("Sets the label of the Ok button")) <<
-                            Help("--cancel-label=TEXT", tr("Sets the label of the Cancel button")) <<
-                            Help("--modal", tr("Set the modal hint")) <<
-                            Help("--attach=WINDOW", tr("Set the parent window to attach to")));
-        helpDict["calendar"] = CategoryHelp(tr("Calendar options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--day=DAY", tr("Set the calendar day")) <<
-                            Help("--month=MONTH", tr("Set the calendar month")) <<
-                            Help("--year=YEAR", tr("Set the calendar year")) <<
-                            Help("--timeout=TIMEOUT", tr("Set dialog timeout in seconds")) <<
-                            Help("--date-format=PATTERN", tr("Set the format for the returned date")));
-        helpDict["entry"] = CategoryHelp(tr("Text entry options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--entry-text=TEXT", tr("Set the entry text")) <<
-                            Help("--hide-text", tr("Hide the entry text")) <<
-                            Help("--values=v1|v2|v3|...", "QARMA ONLY! " + tr("Offer preset values to pick from")) <<
-                            Help("--int=integer", "QARMA ONLY! " + tr("Integer input only, preset given value")) <<
-                            Help("--float=floating_point", "QARMA ONLY! " + tr("Floating point input only, preset given value")));
-        helpDict["error"] = CategoryHelp(tr("Error options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--icon-name=ICON-NAME", tr("Set the dialog icon")) <<
-                            Help("--no-wrap", tr("Do not enable text wrapping")) <<
-                            Help("--no-markup", tr("Do not enable html markup")) <<
-                            Help("--ellipsize", tr("Do wrap text, zenity has a rather special problem here")) <<
-                            Help("--selectable-labels", "QARMA ONLY! " + tr("Allow to select text for copy and paste")));
-        helpDict["info"] = CategoryHelp(tr("Info options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--icon-name=ICON-NAME", tr("Set the dialog icon")) <<
-                            Help("--no-wrap", tr("Do not enable text wrapping")) <<
-                            Help("--no-markup", tr("Do not enable html markup")) <<
-                            Help("--ellipsize", tr("Do wrap text, zenity has a rather special problem here")) <<
-                            Help("--selectable-labels", "QARMA ONLY! " + tr("Allow to select text for copy and paste")));
-        helpDict["file-selection"] = CategoryHelp(tr("File selection options"), HelpList() <<
-                            Help("--filename=FILENAME", tr("Set the filename")) <<
-                            Help("--multiple", tr("Allow multiple files to be selected")) <<
-                            Help("--directory", tr("Activate directory-only selection")) <<
-                            Help("--save", tr("Activate save mode")) <<
-                            Help("--separator=SEPARATOR", tr("Set output separator character")) <<
-                            Help("--confirm-overwrite", tr("Confirm file selection if filename already exists")) <<
-                            Help("--file-filter=NAME | PATTERN1 PATTERN2 ...", tr("Sets a filename filter")));
-        helpDict["list"] = CategoryHelp(tr("List options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--column=COLUMN", tr("Set the column header")) <<
-                            Help("--checklist", tr("Use check boxes for first column")) <<
-                            Help("--radiolist", tr("Use radio buttons for first column")) <<
-                            Help("--imagelist", tr("Use an image for first column")) <<
-                            Help("--separator=SEPARATOR", tr("Set output separator character")) <<
-                            Help("--multiple", tr("Allow multiple rows to be selected")) <<
-                            Help("--editable", tr("Allow changes to text")) <<
-                            Help("--print-column=NUMBER", tr("Print a specific column (Default is 1. 'ALL' can be used to print all columns)")) <<
-                            Help("--hide-column=NUMBER", tr("Hide a specific column")) <<
-                            Help("--hide-header", tr("Hides the column headers")) <<
-                            Help("--mid-search", tr("Change list default search function searching for text in the middle, not on the beginning")));
-        helpDict["notification"] = CategoryHelp(tr("Notification icon options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--listen", tr("Listen for commands on stdin")) <<
-                            Help("--hint=TEXT", tr("Set the notification hints")) <<
-                            Help("--selectable-labels", "QARMA ONLY! " + tr("Allow to select text for copy and paste")));
-        helpDict["progress"] = CategoryHelp(tr("Progress options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--percentage=PERCENTAGE", tr("Set initial percentage")) <<
-                            Help("--pulsate", tr("Pulsate progress bar")) <<
-                            Help("--auto-close", tr("Dismiss the dialog when 100% has been reached")) <<
-                            Help("--auto-kill", tr("Kill parent process if Cancel button is pressed")) <<
-                            Help("--no-cancel", tr("Hide Cancel button")));
-        helpDict["question"] = CategoryHelp(tr("Question options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--icon-name=ICON-NAME", tr("Set the dialog icon")) <<
-                            Help("--no-wrap", tr("Do not enable text wrapping")) <<
-                            Help("--no-markup", tr("Do not enable html markup")) <<
-                            Help("--default-cancel", tr("Give cancel button focus by default")) <<
-                            Help("--ellipsize", tr("Do wrap text, zenity has a rather special problem here")) <<
-                            Help("--selectable-labels", "QARMA ONLY! " + tr("Allow to select text for copy and paste")));
-        helpDict["warning"] = CategoryHelp(tr("Warning options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--icon-name=ICON-NAME", tr("Set the dialog icon")) <<
-                            Help("--no-wrap", tr("Do not enable text wrapping")) <<
-                            Help("--no-markup", tr("Do not enable html markup")) <<
-                            Help("--ellipsize", tr("Do wrap text, zenity has a rather special problem here")) <<
-                            Help("--selectable-labels", "QARMA ONLY! " + tr("Allow to select text for copy and paste")));
-        helpDict["scale"] = CategoryHelp(tr("Scale options"), HelpList() <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--value=VALUE", tr("Set initial value")) <<
-                            Help("--min-value=VALUE", tr("Set minimum value")) <<
-                            Help("--max-value=VALUE", tr("Set maximum value")) <<
-                            Help("--step=VALUE", tr("Set step size")) <<
-                            Help("--print-partial", tr("Print partial values")) <<
-                            Help("--hide-value", tr("Hide value")));
-        helpDict["text-info"] = CategoryHelp(tr("Text information options"), HelpList() <<
-                            Help("--filename=FILENAME", tr("Open file")) <<
-                            Help("--editable", tr("Allow changes to text")) <<
-                            Help("--font=TEXT", tr("Set the text font")) <<
-                            Help("--checkbox=TEXT", tr("Enable an I read and agree checkbox")) <<
-                            Help("--plain", "QARMA ONLY! " + tr("Force plain text, zenity default limitation")) <<
-                            Help("--html", tr("Enable HTML support")) <<
-                            Help("--no-interaction", tr("Do not enable user interaction with the WebView. Only works if you use --html option")) <<
-                            Help("--url=URL", "REQUIRES CURL BINARY! " + tr("Set an URL instead of a file. Only works if you use --html option")) <<
-                            Help("--auto-scroll", tr("Auto scroll the text to the end. Only when text is captured from stdin")));
-        helpDict["color-selection"] = CategoryHelp(tr("Color selection options"), HelpList() <<
-                            Help("--color=VALUE", tr("Set the color")) <<
-                            Help("--show-palette", tr("Show the palette")) <<
-                            Help("--custom-palette=path/to/some.gpl",  "QARMA ONLY! " + tr("Load a custom GPL for standard colors")));
-        helpDict["font-selection"] = CategoryHelp(tr("Font selection options"), HelpList() <<
-                            Help("--type=[vector][,bitmap][,fixed][,variable]", tr("Filter fonts (default: all)")) <<
-                            Help("--pattern=%1-%2:%3:%4", tr("Output pattern, %1: Name, %2: Size, %3: weight, %4: slant")) <<
-                            Help("--sample=TEXT", tr("Sample text, defaults to the foxdogthing")));
-        helpDict["password"] = CategoryHelp(tr("Password dialog options"), HelpList() <<
-                            Help("--username", tr("Display the username option")) <<
-                            Help("--prompt=TEXT", "QARMA ONLY! " + tr("The prompt for the user")));
-        helpDict["forms"] = CategoryHelp(tr("Forms dialog options"), HelpList() <<
-                            Help("--add-entry=Field name", tr("Add a new Entry in forms dialog")) <<
-                            Help("--add-password=Field name", tr("Add a new Password Entry in forms dialog")) <<
-                            Help("--add-calendar=Calendar field name", tr("Add a new Calendar in forms dialog")) <<
-                            Help("--add-list=List field and header name", tr("Add a new List in forms dialog")) <<
-                            Help("--list-values=List of values separated by |", tr("List of values for List")) <<
-                            Help("--column-values=List of values separated by |", tr("List of values for columns")) <<
-                            Help("--add-combo=Combo box field name", tr("Add a new combo box in forms dialog")) <<
-                            Help("--combo-values=List of values separated by |", tr("List of values for combo box")) <<
-                            Help("--show-header", tr("Show the columns header")) <<
-                            Help("--text=TEXT", tr("Set the dialog text")) <<
-                            Help("--separator=SEPARATOR", tr("Set output separator character")) <<
-                            Help("--forms-date-format=PATTERN", tr("Set the format for the returned date")) <<
-                            Help("--add-checkbox=Checkbox label", "QARMA ONLY! " + tr("Add a new Checkbox forms dialog")));
-        helpDict["misc"] = CategoryHelp(tr("Miscellaneous options"), HelpList() <<
-                            Help("--about", tr("About Qarma")) <<
-                            Help("--version", tr("Print version")));
-        helpDict["qt"] = CategoryHelp(tr("Qt options"), HelpList() <<
-                            Help("--foo", tr("Foo")) <<
-                            Help("--bar", tr("Bar")));
-        helpDict["application"] = CategoryHelp(tr("Application Options"), HelpList() <<
-                            Help("--calendar", tr("Display calendar dialog")) <<
-                            Help("--entry", tr("Display text entry dialog")) <<
-                            Help("--error", tr("Display error dialog")) <<
-                            Help("--info", tr("Display info dialog")) <<
-                            Help("--file-selection", tr("Display file selection dialog")) <<
-                            Help("--list", tr("Display list dialog")) <<
-                            Help("--notification", tr("Display notification")) <<
-                            Help("--progress", tr("Display progress indication dialog")) <<
-                            Help("--question", tr("Display question dialog")) <<
-                            Help("--warning", tr("Display warning dialog")) <<
-                            Help("--scale", tr("Display scale dialog")) <<
-                            Help("--text-info", tr("Display text information dialog")) <<
-                            Help("--color-selection", tr("Display color selection dialog")) <<
-                            Help("--font-selection", "QARMA ONLY! " + tr("Display font selection dialog")) <<
-                            Help("--password", tr("Display password dialog")) <<
-                            Help("--forms", tr("Display forms dialog")) <<
-                            Help("--display=DISPLAY", tr("X display to use")));
+    while (size > 0) {
+        const ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
     }
+    return true;
+}
 
-    if (category == "all") {
-        foreach(const CategoryHelp &el, helpDict) {
-            printf("%s\n", qPrintable(el.first));
-            foreach (const Help &help, el.second)
-                printf("  %-53s%s\n", qPrintable(help.first), qPrintable(help.second));
-            printf("\n");
+static bool sendFds(int sock, const int *fds, int count, const QByteArray &payload)
+{
+    char control[CMSG_SPACE(3*sizeof(int))];
+    memset(control, 0, sizeof(control));
+    iovec iov;
+    iov.iov_base = const_cast<char*>(payload.constData());
+    iov.iov_len = payload.size();
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(count*sizeof(int));
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(count*sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, count*sizeof(int));
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    return n > 0 && writeFully(sock, payload.constData() + n, payload.size() - n);
+}
+
+static bool receiveFds(int sock, int *fds, int count, char *data, int size)
+{
+    char control[CMSG_SPACE(3*sizeof(int))];
+    iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(count*sizeof(int));
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, 0);
+    } while (n < 0 && errno == EINTR);
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (n <= 0 || !cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(count*sizeof(int)))
+        return false;
+    memcpy(fds, CMSG_DATA(cmsg), count*sizeof(int));
+    return readFully(sock, data + n, size - n);
+}
+
+// Qt consumes these when it builds the QApplication, the warm instance did that long ago
+static bool hasQtOptions(int argc, char **argv)
+{
+    static const char *const qtOptions[] = {
+        "-platform", "-platformpluginpath", "-platformtheme", "-plugin", "-qwindowgeometry", "-geometry",
+        "-qwindowicon", "-icon", "-qwindowtitle", "-reverse", "-session", "-display", "-name", "-style",
+        "-stylesheet", "-widgetcount", "-nograb", "-dograb", "-sync", "-qmljsdebugger", "-testability"
+    };
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (arg[0] != '-')
+            continue;
+        if (arg[1] == '-')
+            ++arg; // Qt takes either form
+        if (!strncmp(arg, "-style=", 7) || !strncmp(arg, "-stylesheet=", 12))
+            return true;
+        for (const char *option : qtOptions) {
+            if (!strcmp(arg, option))
+                return true;
         }
-        return;
     }
+    return false;
+}
 
-    HelpDict::const_iterator it = helpDict.constEnd();
-    if (!category.isEmpty())
-        it = helpDict.find(category);
+// The warm instance is connected to the display and D-Bus and has loaded its style, fonts and
+// translations according to its own environment, a caller that differs there runs standalone.
+static QMap<QByteArray, QByteArray> sessionEnvironment(const QList<QByteArray> &environment)
+{
+    QMap<QByteArray, QByteArray> session;
+    foreach (const QByteArray &variable, environment) {
+        const int value = variable.indexOf('=');
+        const QByteArray name = variable.left(value);
+        if (value > 0 && (name == "DISPLAY" || name == "WAYLAND_DISPLAY" || name == "XAUTHORITY" ||
+                          name == "DBUS_SESSION_BUS_ADDRESS" || name == "LANG" || name == "LANGUAGE" ||
+                          name.startsWith("LC_") || name.startsWith("QT_") || name.startsWith("XDG_")))
+            session.insert(name, variable.mid(value + 1));
+    }
+    return session;
+}
 
-    if (it == helpDict.constEnd()) {
-        printf("Usage:\n  %s [OPTION ...]\n\n", qPrintable(applicationName()));
-        printHelp("help");
-        printHelp("application");
-        return;
+static QList<QByteArray> currentEnvironment()
+{
+    QList<QByteArray> environment;
+    for (char **variable = environ; *variable; ++variable)
+        environment << QByteArray(*variable);
+    return environment;
+}
+
+// request: quint32 parent pid, quint32 argc, quint32 payload size,
+//          payload = cwd\0argv[0]\0argv[1]...\0NAME=VALUE\0NAME=VALUE...
+// reply: qint32 accepted, then qint32 exit status
+static int runClient(int argc, char **argv)
+{
+    const QByteArray path = daemonSocketPath();
+    if (path.isEmpty() || hasQtOptions(argc, argv))
+        return -1;
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.constData(), sizeof(addr.sun_path) - 1);
+    const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+    if (::connect(sock, (sockaddr*)&addr, sizeof(addr)) < 0 || !peerIsUs(sock)) {
+        close(sock);
+        return -1; // no daemon (of ours), run standalone
     }
 
-    printf("%s\n", qPrintable(it->first));
-    foreach (const Help &help, it->second)
-        printf("  %-53s%s\n", qPrintable(help.first), qPrintable(help.second));
-    printf("\n");
+    QByteArray payload;
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)))
+        payload += cwd;
+    for (int i = 0; i < argc; ++i)
+        payload += '\0' + QByteArray(argv[i]);
+    foreach (const QByteArray &variable, currentEnvironment())
+        payload += '\0' + variable;
+    const quint32 header[3] = { quint32(getppid()), quint32(argc), quint32(payload.size()) };
+    const int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    qint32 accepted = 0;
+    if (!sendFds(sock, fds, 3, QByteArray((const char*)header, sizeof(header)) + payload) ||
+        !readFully(sock, (char*)&accepted, sizeof(accepted)) || !accepted) {
+        close(sock);
+        return -1; // different session, nothing has been touched yet
+    }
+    qint32 status = 1;
+    if (!readFully(sock, (char*)&status, sizeof(status)))
+        status = 1; // the serving instance died
+    close(sock);
+    return status;
+}
+
+static int serveClient(int channel, int &argc, char **argv)
+{
+    // that's the expensive part, done before anyone asks for it
+    Qarma app(argc, argv, true);
+
+    int client;
+    char dummy;
+    if (!receiveFds(channel, &client, 1, &dummy, 1))
+        return 1;
+    close(channel);
+
+    int fds[3];
+    quint32 header[3];
+    if (!receiveFds(client, fds, 3, (char*)header, sizeof(header)))
+        return 1;
+    QByteArray payload(header[2], Qt::Uninitialized);
+    if (!readFully(client, payload.data(), payload.size()))
+        return 1;
+    QList<QByteArray> environment = payload.split('\0');
+    const QByteArray cwd = environment.takeFirst();
+    QStringList args;
+    while (args.count() < int(header[1]) && !environment.isEmpty())
+        args << QString::fromLocal8Bit(environment.takeFirst());
+
+    const qint32 accepted = args.count() > 1 &&
+                            sessionEnvironment(environment) == sessionEnvironment(currentEnvironment());
+    if (!writeFully(client, (const char*)&accepted, sizeof(accepted)) || !accepted)
+        return 0;
+
+    // everything else (PATH for curl, HOME, ...) is simply taken over
+    foreach (const QByteArray &variable, currentEnvironment())
+        unsetenv(variable.left(variable.indexOf('=')).constData());
+    foreach (const QByteArray &variable, environment) {
+        const int value = variable.indexOf('=');
+        if (value > 0)
+            setenv(variable.left(value).constData(), variable.constData() + value + 1, 1);
+    }
+    for (int i = 0; i < 3; ++i) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+    gs_parentPid = header[0];
+    QDir::setCurrent(QString::fromLocal8Bit(cwd));
+
+    // The caller only waits for the status from here on, so the socket becoming readable means
+    // it went away (^C, timeout(1), its script ended). That ends the dialog like it would have
+    // ended a standalone qarma - and nothing must be written to the caller's stdio anymore.
+    bool hungUp = false;
+    QSocketNotifier hangup(client, QSocketNotifier::Read);
+    QObject::connect(&hangup, &QSocketNotifier::activated, &app, [&]() {
+        char c;
+        const ssize_t n = recv(client, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return;
+        hangup.setEnabled(false);
+        if (n > 0)
+            return; // not a hangup, just not our protocol
+        hungUp = true;
+        const int null = open("/dev/null", O_RDWR);
+        for (int i = 0; i < 3; ++i)
+            dup2(null, i);
+        close(null);
+        app.exit(128 + SIGHUP);
+    });
+
+    app.dispatch(args);
+    const qint32 status = app.exec();
+    fflush(stdout);
+    fflush(stderr);
+    if (!hungUp)
+        writeFully(client, (const char*)&status, sizeof(status));
+    close(client);
+    return status;
+}
+
+static int runDaemon(int &argc, char **argv)
+{
+    const QByteArray path = daemonSocketPath();
+    if (path.isEmpty()) {
+        fprintf(stderr, "qarma --daemon: XDG_RUNTIME_DIR must be set to a directory only you can access\n");
+        return 1;
+    }
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.constData(), sizeof(addr.sun_path) - 1);
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.constData());
+    umask(077);
+    if (listener < 0 || bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 16) < 0) {
+        perror("qarma --daemon");
+        return 1;
+    }
+    signal(SIGCHLD, SIG_IGN); // the warm instances reap themselves
+
+    while (true) {
+        int channel[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0) {
+            perror("qarma --daemon");
+            return 1;
+        }
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("qarma --daemon");
+            return 1;
+        }
+        if (pid == 0) {
+            signal(SIGCHLD, SIG_DFL);
+            close(listener);
+            close(channel[0]);
+            return serveClient(channel[1], argc, argv);
+        }
+        close(channel[1]);
+
+        int client = -1;
+        while (client < 0) {
+            client = accept(listener, NULL, NULL);
+            if (client < 0 && errno != EINTR) {
+                perror("qarma --daemon");
+                return 1;
+            }
+            if (client > -1 && !peerIsUs(client)) { // the warm instance waits for the next one
+                close(client);
+                client = -1;
+            }
+        }
+        sendFds(channel[0], &client, 1, QByteArray(1, '\0'));
+        close(client);
+        close(channel[0]);
+    }
+    return 0;
+}
+#endif
+
+// Qt5 takes "--title TITLE" for itself and later slaps it onto the first QWindow it shows,
+// racing our own setWindowTitle(). "--title=TITLE" is left alone and gets canonicalized
+// into the very same arguments, so merge the pair before QApplication gets to see it.
+static void protectTitle(int &argc, char **argv)
+{
+    for (int i = 1; i < argc - 1; ++i) {
+        if (strcmp(argv[i], "--title"))
+            continue;
+        argv[i] = strdup(QByteArray("--title=" + QByteArray(argv[i+1])).constData()); // must live as long as argv
+        memmove(&argv[i+1], &argv[i+2], (argc - i - 2)*sizeof(char*));
+        argv[--argc] = NULL;
+    }
 }
 
 int main (int argc, char **argv)
 {
+    StartupTrace::start();
     if (argc < 2) {
         Qarma::printHelp();
         return 1;
     }
 
-    bool helpMission = false;
+    bool helpMission = false, check = false;
     for (int i = 1; i < argc; ++i) {
         const QString arg(argv[i]);
         if (arg == "-h" || arg.startsWith("--help")) {
             helpMission = true;
             Qarma::printHelp(arg.mid(7)); // "--help-"
         }
+        check = check || arg == "--check";
     }
 
     if (helpMission) {
         return 0;
     }
 
+    if (check)
+        return checkArguments(argc, argv);
+
+#ifdef Q_OS_UNIX
+    if (!strcmp(argv[1], "--daemon"))
+        return runDaemon(argc, argv);
+    const int status = runClient(argc, argv);
+    if (status > -1)
+        return status;
+#endif
+
+    protectTitle(argc, argv);
     Qarma d(argc, argv);
     return d.exec();
 }
@@ -19,8 +19,10 @@
 #ifndef QARMA_H
 #define QARMA_H
 
+class QDBusInterface;
+class QDBusPendingCallWatcher;
 class QDialog;
-class QTreeWidgetItem;
+class QTimer;
 
 #include <QApplication>
 #include <QPair>
@@ -29,10 +31,11 @@ class Qarma : public QApplication
 {
     Q_OBJECT
 public:
-    Qarma(int &argc, char **argv);
+    Qarma(int &argc, char **argv, bool deferred = false);
     enum Type { Invalid, Calendar, Entry, Error, Info, FileSelection, List, Notification, Progress, Question, Warning,
                 Scale, TextInfo, ColorSelection, FontSelection, Password, Forms };
     static void printHelp(const QString &category = QString());
+    void dispatch(QStringList argList);
 private:
     char showCalendar(const QStringList &args);
     char showEntry(const QStringList &args);
@@ -41,6 +44,7 @@ private:
     char showMessage(const QStringList &args, char type);
 
     char showFileSelection(const QStringList &args);
+    char showFilePicker(const QStringList &args);
     char showList(const QStringList &args);
     char showNotification(const QStringList &args);
     char showProgress(const QStringList &args);
@@ -53,6 +57,7 @@ private:
     bool error(const QString message);
     void listenToStdIn();
     void notify(const QString message, bool noClose = false);
+    void notificationSent(QDBusPendingCallWatcher *call);
 
     QString labelText(const QString &s) const; // m_zenity requires \n and \t interpretation in html.
 private slots:
@@ -60,14 +65,21 @@ private slots:
     void printInteger(int v);
     void quitOnError();
     void readStdIn();
-    void toggleItems(QTreeWidgetItem *item, int column);
     void finishProgress();
+    void updateProgress();
 private:
     bool m_helpMission, m_modal, m_zenity, m_selectableLabel;
     QString m_caption, m_icon, m_ok, m_cancel, m_notificationHints;
     QSize m_size;
-    int m_parentWindow, m_timeout;
+    int m_parentWindow, m_timeout, m_outputFormat;
     uint m_notificationId;
+    QString m_progressLabel;
+    int m_progressValue;
+    bool m_progressLabelPending;
+    QTimer *m_progressTimer;
+    QDBusInterface *m_notifications;
+    QDBusPendingCallWatcher *m_notifyCall;
+    QString m_pendingNotification;
     QDialog *m_dialog;
     Type m_type;
 };
@@ -8,4 +8,15 @@ unix:!macx:LIBS    += -lX11
 unix:!macx:DEFINES += WS_X11
 
 target.path += /usr/bin
-INSTALLS += target
\ No newline at end of file
+INSTALLS += target
+
+# "make benchmark" reports the startup time of every dialog type and the stdin throughput,
+# see tests/benchmark.sh and tests/throughput.sh
+benchmark.commands = $$PWD/tests/benchmark.sh $$OUT_PWD/$$TARGET && $$PWD/tests/throughput.sh $$OUT_PWD/$$TARGET
+benchmark.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += benchmark
+
+# "make check" builds and runs the tests, see tests/tests.pro
+check.commands = mkdir -p tests && cd tests && $(QMAKE) $$PWD/tests/tests.pro && $(MAKE) check
+check.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += check
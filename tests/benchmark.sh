@@ -0,0 +1,88 @@
+#!/bin/sh
+# Startup benchmark, run by "make benchmark".
+#
+#   tests/benchmark.sh [QARMA] [RUNS]
+#
+# Every dialog type is started headless (offscreen QPA) with QARMA_TRACE=1 and the time of its
+# first paint is reported as median, 90th percentile and maximum, cold and warm. Cold runs drop
+# the page cache first, which needs root - otherwise only the first run of each type is cold.
+# The times are the ones of the trace, ie. since main().
+
+QARMA=${1:-./qarma}
+RUNS=${2:-20}
+export QT_QPA_PLATFORM=offscreen QARMA_TRACE=1
+TRACE=$(mktemp)
+trap 'rm -f "$TRACE"' EXIT
+
+# runs qarma with the given arguments until its first paint, prints the time of that
+firstPaint() {
+    : > "$TRACE"
+    "$QARMA" "$@" < /dev/null > /dev/null 2> "$TRACE" &
+    pid=$!
+    tries=0
+    while ! grep -q "first paint" "$TRACE" && kill -0 $pid 2> /dev/null && [ $tries -lt 500 ]; do
+        sleep 0.01
+        tries=$((tries + 1))
+    done
+    kill $pid 2> /dev/null
+    wait $pid 2> /dev/null
+    sed -n 's/^qarma trace: *\([0-9.]*\) ms  first paint$/\1/p' "$TRACE"
+}
+
+dropCaches() {
+    sync
+    echo 3 > /proc/sys/vm/drop_caches
+}
+
+# median, 90th percentile and maximum of the numbers on stdin
+percentiles() {
+    sort -n | awk 'NF { v[++n] = $1 }
+        END { if (n) printf "%8.1f %8.1f %8.1f", v[int((n + 1)/2)], v[int(n*0.9 + 0.999)], v[n];
+              else printf "%8s %8s %8s", "-", "-", "-" }'
+}
+
+if [ ! -x "$QARMA" ]; then
+    echo "$QARMA is not executable" >&2
+    exit 1
+fi
+[ -w /proc/sys/vm/drop_caches ] || echo "not allowed to drop the page cache, only the first runs are cold" >&2
+
+printf "%-16s %26s   %26s\n" "" "cold (ms)" "warm (ms)"
+printf "%-16s %8s %8s %8s   %8s %8s %8s\n" "" median p90 max median p90 max
+while read -r name args; do
+    set -f
+    set -- $args
+    set +f
+    cold=
+    warm=
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        if [ -w /proc/sys/vm/drop_caches ]; then
+            dropCaches
+            cold="$cold $(firstPaint "$@")"
+        elif [ $i -eq 0 ]; then
+            cold=$(firstPaint "$@")
+            i=$((i + 1))
+            continue
+        fi
+        warm="$warm $(firstPaint "$@")"
+        i=$((i + 1))
+    done
+    printf "%-16s %s   %s\n" "$name" "$(echo $cold | tr ' ' '\n' | percentiles)" "$(echo $warm | tr ' ' '\n' | percentiles)"
+done <<DIALOGS
+calendar --calendar
+color-selection --color-selection
+entry --entry --text=benchmark
+error --error --text=benchmark
+file-selection --file-selection
+font-selection --font-selection
+forms --forms --add-entry=benchmark
+info --info --text=benchmark
+list --list --column=a --column=b 1 2 3 4
+password --password
+progress --progress --text=benchmark
+question --question --text=benchmark
+scale --scale
+text-info --text-info
+warning --warning --text=benchmark
+DIALOGS
@@ -0,0 +1,3 @@
+include(../qarma.pri)
+TARGET  = tst_help
+SOURCES = tst_help.cpp
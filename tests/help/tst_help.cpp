@@ -0,0 +1,129 @@
+/*
+ *   Qarma - a Zenity clone for Qt4 and Qt5
+ *   Copyright 2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#define main qarma_main
+#include "Qarma.cpp"
+#undef main
+
+#include <QTranslator>
+#include <QtTest>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Counts what the help asks to be translated, the help is constexpr data and only the
+// requested category may be translated.
+class CountingTranslator : public QTranslator
+{
+public:
+    bool isEmpty() const override { return false; }
+    QString translate(const char *context, const char *sourceText, const char *disambiguation, int n) const override {
+        Q_UNUSED(context); Q_UNUSED(disambiguation); Q_UNUSED(n);
+        ++count;
+        return QString::fromUtf8(sourceText);
+    }
+    mutable int count = 0;
+};
+
+// printHelp() prints to stdout, which is where the test log goes as well
+class Silence
+{
+public:
+    Silence() {
+        fflush(stdout);
+        m_stdout = dup(STDOUT_FILENO);
+        const int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    }
+    ~Silence() {
+        fflush(stdout);
+        dup2(m_stdout, STDOUT_FILENO);
+        close(m_stdout);
+    }
+private:
+    int m_stdout;
+};
+
+class HelpTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void translatesOnlyTheCategory_data();
+    void translatesOnlyTheCategory();
+    void printHelp_data();
+    void printHelp();
+private:
+    CountingTranslator m_translator;
+};
+
+void HelpTest::initTestCase()
+{
+    QVERIFY(QCoreApplication::installTranslator(&m_translator));
+}
+
+void HelpTest::cleanupTestCase()
+{
+    QCoreApplication::removeTranslator(&m_translator);
+}
+
+void HelpTest::translatesOnlyTheCategory_data()
+{
+    QTest::addColumn<QString>("category");
+    QTest::addColumn<int>("translations");
+    int all = 0;
+    for (const HelpCategory &help : gs_helpCategories) {
+        QTest::newRow(help.name) << QString(help.name) << help.count + 1; // + the title
+        all += help.count + 1;
+    }
+    QTest::newRow("all") << QString("all") << all;
+    QTest::newRow("usage") << QString() << helpCategory("help")->count + 1 + helpCategory("application")->count + 1;
+}
+
+void HelpTest::translatesOnlyTheCategory()
+{
+    QFETCH(QString, category);
+    QFETCH(int, translations);
+    m_translator.count = 0;
+    {
+        Silence silence;
+        Qarma::printHelp(category);
+    }
+    QCOMPARE(m_translator.count, translations);
+}
+
+void HelpTest::printHelp_data()
+{
+    QTest::addColumn<QString>("category");
+    QTest::newRow("--help-list") << QString("list");
+    QTest::newRow("--help-all") << QString("all");
+}
+
+void HelpTest::printHelp()
+{
+    QFETCH(QString, category);
+    Silence silence;
+    QBENCHMARK {
+        Qarma::printHelp(category);
+    }
+}
+
+QTEST_GUILESS_MAIN(HelpTest)
+#include "tst_help.moc"
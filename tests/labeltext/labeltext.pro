@@ -0,0 +1,3 @@
+include(../qarma.pri)
+TARGET  = tst_labeltext
+SOURCES = tst_labeltext.cpp
@@ -0,0 +1,145 @@
+/*
+ *   Qarma - a Zenity clone for Qt4 and Qt5
+ *   Copyright 2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#define main qarma_main
+#include "Qarma.cpp"
+#undef main
+
+#include <QRandomGenerator>
+#include <QRegExp>
+#include <QtTest>
+
+// The chain of replacements labelText() used to be, the single pass must not differ from it.
+// The only change is the bounds check in the digit count, at() asserts past the end.
+static QString replacementChain(const QString &s)
+{
+    QString r = s;
+    r.replace("\\\\", "\a") \
+     .replace("\\n", "<br>").replace("\\t", "&nbsp;&nbsp;&nbsp;") \
+     .replace("\\r", "<br>");
+    int idx = 0;
+    while (true) {
+        idx = r.indexOf(QRegExp("\\\\([0-9]{1,3})"), idx);
+        if (idx < 0)
+            break;
+        int sz = 0;
+        while (sz < 3 && idx+sz+1 < r.size() && r.at(idx+sz+1).isDigit())
+            ++sz;
+        r.replace(idx, sz+1, QChar(r.midRef(idx+1, sz).toUInt(nullptr, 8)));
+    }
+    r.remove("\\").replace(("\a"), "\\");
+    return r;
+}
+
+class LabelTextTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void regression_data();
+    void regression();
+    void random();
+    void benchmark_data();
+    void benchmark();
+};
+
+void LabelTextTest::regression_data()
+{
+    QTest::addColumn<QString>("label");
+    QTest::addColumn<QString>("expected");
+    const QChar arabicThree(0x0663);
+    QTest::newRow("plain") << "no escapes" << "no escapes";
+    QTest::newRow("markup") << "<b>bold</b> &amp;" << "<b>bold</b> &amp;";
+    QTest::newRow("line breaks") << "a\\nb\\rc" << "a<br>b<br>c";
+    QTest::newRow("tab") << "a\\tb" << "a&nbsp;&nbsp;&nbsp;b";
+    QTest::newRow("escaped backslash") << "a\\\\b" << "a\\b";
+    QTest::newRow("escaped backslash, n") << "a\\\\nb" << "a\\nb";
+    QTest::newRow("three backslashes, n") << "a\\\\\\nb" << "a\\<br>b";
+    QTest::newRow("unknown escape") << "\\q\\\"" << "q\"";
+    QTest::newRow("trailing backslash") << "a\\" << "a";
+    QTest::newRow("BEL") << "a\ab" << "a\\b";
+    QTest::newRow("backslash, BEL") << "\\\a" << "\\";
+    QTest::newRow("octal") << "\\101\\102" << "AB";
+    QTest::newRow("short octal") << "\\61x\\62" << "1x2";
+    QTest::newRow("four digits") << "\\1012" << "A2";
+    QTest::newRow("octal BEL") << "\\7" << "\\";
+    QTest::newRow("long octal BEL") << "\\007" << "\\";
+    QTest::newRow("octal backslash") << "a\\134b" << "ab";
+    QTest::newRow("octal backslash, n") << "\\134n" << "n";
+    QTest::newRow("octal backslash, digit") << "\\1341" << QString(QChar(1));
+    QTest::newRow("octal backslash, octal") << "\\134\\060" << "0";
+    QTest::newRow("octal backslash twice") << "\\134134101" << "A";
+    QTest::newRow("escaped backslash, digit") << "\\\\101" << "\\101";
+    QTest::newRow("8") << "\\8" << QString(QChar(0));
+    QTest::newRow("9 among octal") << "\\191x" << QString(QChar(0)) + "x";
+    QTest::newRow("zero") << "a\\0b" << QString("a") + QChar(0) + "b";
+    QTest::newRow("arabic digit") << QString("\\1") + arabicThree + "2" << QString(QChar(0)); // three digits, not octal
+    QTest::newRow("arabic after backslash") << QString("\\") + arabicThree << QString(arabicThree);
+    QTest::newRow("511") << "\\777" << QString(QChar(0777));
+}
+
+void LabelTextTest::regression()
+{
+    QFETCH(QString, label);
+    QFETCH(QString, expected);
+    QCOMPARE(replacementChain(label), expected); // the test itself is right
+    QCOMPARE(zenityLabelText(label), expected);
+}
+
+// the single pass and the chain of replacements agree on whatever the escapes are made of
+void LabelTextTest::random()
+{
+    const QString alphabet = QString("\\\\\\\\ntr01234789a <\a") + QChar(0x0663);
+    QRandomGenerator random(20140101);
+    for (int i = 0; i < 200000; ++i) {
+        QString label;
+        for (int n = random.bounded(16); n > 0; --n)
+            label += alphabet.at(random.bounded(alphabet.size()));
+        const QString expected = replacementChain(label);
+        const QString result = zenityLabelText(label);
+        if (result != expected)
+            QFAIL(qPrintable(QString("%1 -> %2, expected %3").arg(QString(label.toUtf8().toPercentEncoding()),
+                                                                QString(result.toUtf8().toPercentEncoding()),
+                                                                QString(expected.toUtf8().toPercentEncoding()))));
+    }
+}
+
+void LabelTextTest::benchmark_data()
+{
+    QTest::addColumn<bool>("chain");
+    QTest::newRow("single pass") << false;
+    QTest::newRow("replacement chain") << true;
+}
+
+// progress labels, which may change many times per second
+void LabelTextTest::benchmark()
+{
+    QFETCH(bool, chain);
+    QStringList labels;
+    for (int i = 0; i < 100; ++i) {
+        labels << QString("Copying file %1 of 100").arg(i)
+               << QString("<b>Step %1</b>\\n\\tinstalling /usr/lib/package-%1.so").arg(i)
+               << QString("Progress: %1% \\342\\200\\224 \\\\server\\share").arg(i);
+    }
+    QBENCHMARK {
+        for (const QString &label : labels)
+            chain ? replacementChain(label) : zenityLabelText(label);
+    }
+}
+
+QTEST_APPLESS_MAIN(LabelTextTest)
+#include "tst_labeltext.moc"
@@ -0,0 +1,7 @@
+# Runs the qarma binary against a mock notification server, "make check" builds it first
+QT      += dbus testlib
+QT      -= gui
+CONFIG  += testcase
+TARGET  = tst_notifications
+SOURCES = tst_notifications.cpp
+DEFINES += QARMA_BINARY=\\\"$$OUT_PWD/../../qarma\\\"
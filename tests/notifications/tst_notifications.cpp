@@ -0,0 +1,137 @@
+/*
+ *   Qarma - a Zenity clone for Qt4 and Qt5
+ *   Copyright 2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusContext>
+#include <QDBusMessage>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTimer>
+#include <QtTest>
+
+// Stands in for the notification server. It answers late, like a busy one would, so
+// messages that arrive meanwhile have to be coalesced by qarma.
+class MockNotifications : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Notifications")
+public:
+    QStringList bodies;
+    QList<uint> replacesIds;
+    uint lastId = 0;
+    int delay = 20;
+public slots:
+    uint Notify(const QString &appName, uint replacesId, const QString &icon, const QString &summary,
+                const QString &body, const QStringList &actions, const QVariantMap &hints, int timeout) {
+        Q_UNUSED(appName); Q_UNUSED(icon); Q_UNUSED(summary);
+        Q_UNUSED(actions); Q_UNUSED(hints); Q_UNUSED(timeout);
+        bodies << body;
+        replacesIds << replacesId;
+        const uint id = replacesId ? replacesId : ++lastId;
+        setDelayedReply(true);
+        const QDBusMessage reply = message().createReply(id);
+        QTimer::singleShot(delay, this, [=]() { QDBusConnection::sessionBus().send(reply); });
+        return id;
+    }
+};
+
+// Needs a session bus without a notification server, eg. "dbus-run-session make check"
+class NotificationsTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+    void oneShot();
+    void burst();
+private:
+    void start(QProcess &qarma, const QStringList &args);
+    MockNotifications m_server;
+};
+
+void NotificationsTest::initTestCase()
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected())
+        QSKIP("no D-Bus session bus");
+    if (bus.interface()->isServiceRegistered("org.freedesktop.Notifications"))
+        QSKIP("a notification server is running, use a private session bus");
+    QVERIFY(bus.registerObject("/org/freedesktop/Notifications", &m_server, QDBusConnection::ExportAllSlots));
+    QVERIFY(bus.registerService("org.freedesktop.Notifications"));
+}
+
+void NotificationsTest::init()
+{
+    m_server.bodies.clear();
+    m_server.replacesIds.clear();
+}
+
+void NotificationsTest::cleanupTestCase()
+{
+    QDBusConnection::sessionBus().unregisterService("org.freedesktop.Notifications");
+}
+
+void NotificationsTest::start(QProcess &qarma, const QStringList &args)
+{
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    if (!env.contains("QT_QPA_PLATFORM"))
+        env.insert("QT_QPA_PLATFORM", "offscreen");
+    qarma.setProcessEnvironment(env);
+    qarma.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    qarma.start(qEnvironmentVariable("QARMA", QARMA_BINARY), args);
+    QVERIFY2(qarma.waitForStarted(), qPrintable(qarma.errorString()));
+}
+
+void NotificationsTest::oneShot()
+{
+    QProcess qarma;
+    start(qarma, {"--notification", "--text=hello"});
+    // the server lives on this event loop, waitForFinished() would block it
+    QTRY_COMPARE_WITH_TIMEOUT(qarma.state(), QProcess::NotRunning, 10000);
+    QCOMPARE(qarma.exitCode(), 0);
+    QCOMPARE(m_server.bodies, QStringList{"hello"});
+    QCOMPARE(m_server.replacesIds.first(), 0u);
+}
+
+// Messages that arrive while a Notify call is pending collapse into the latest one,
+// which replaces the notification shown before.
+void NotificationsTest::burst()
+{
+    const int count = 500;
+    QProcess qarma;
+    start(qarma, {"--notification", "--listen"});
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 1; i <= count; ++i)
+        qarma.write(QByteArray("message:") + QByteArray::number(i) + '\n');
+
+    QTRY_VERIFY_WITH_TIMEOUT(!m_server.bodies.isEmpty() && m_server.bodies.last() == QString::number(count), 10000);
+    qInfo("%d messages delivered in %lld ms with %d Notify calls", count, timer.elapsed(), m_server.bodies.count());
+    QVERIFY(m_server.bodies.count() < count);
+    QCOMPARE(m_server.replacesIds.first(), 0u);
+    for (int i = 1; i < m_server.replacesIds.count(); ++i)
+        QCOMPARE(m_server.replacesIds.at(i), m_server.lastId);
+
+    qarma.kill();
+    qarma.waitForFinished();
+}
+
+QTEST_GUILESS_MAIN(NotificationsTest)
+#include "tst_notifications.moc"
@@ -0,0 +1,12 @@
+# The tests look at qarma's internals, so each of them compiles Qarma.cpp into itself:
+#   #define main qarma_main
+#   #include "Qarma.cpp"
+#   #undef main
+HEADERS += $$PWD/../Qarma.h
+INCLUDEPATH += $$PWD/..
+QT      += dbus gui widgets testlib
+unix:!macx:QT += x11extras
+CONFIG  += testcase
+
+unix:!macx:LIBS    += -lX11
+unix:!macx:DEFINES += WS_X11
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Stdin throughput benchmark, run by "make benchmark".
+#
+#   tests/throughput.sh [QARMA] [ROWS] [BASELINE]
+#
+# ROWS lines are fed headless (offscreen QPA) into --progress --auto-close, which quits on the
+# final "100", and into a --list, whose QARMA_TRACE=1 "stdin closed" mark tells when they're in.
+# A BASELINE binary (eg. a build of the previous release) is run the same way for comparison,
+# the list needs the trace and is skipped for binaries that don't have it.
+
+QARMA=${1:-./qarma}
+ROWS=${2:-100000}
+BASELINE=$3
+export QT_QPA_PLATFORM=offscreen QARMA_TRACE=1
+INPUT=$(mktemp)
+TRACE=$(mktemp)
+trap 'rm -f "$INPUT" "$TRACE"' EXIT
+
+now() {
+    date +%s%N
+}
+
+# rows per second for ROWS lines in the given ms, "-" if there's no time
+rate() {
+    awk -v rows="$ROWS" -v ms="$1" 'BEGIN { if (ms > 0) printf "%12.0f", rows*1000/ms; else printf "%12s", "-" }'
+}
+
+# wall clock ms until qarma --progress --auto-close has read INPUT and quit
+progress() {
+    start=$(now)
+    "$1" --progress --auto-close < "$INPUT" > /dev/null 2>&1
+    echo $((($(now) - start)/1000000))
+}
+
+# ms since main() until qarma --list has used up INPUT
+list() {
+    : > "$TRACE"
+    "$1" --list --column=a < "$INPUT" > /dev/null 2> "$TRACE" &
+    pid=$!
+    tries=0
+    while ! grep -q "stdin closed" "$TRACE" && kill -0 $pid 2> /dev/null && [ $tries -lt 6000 ]; do
+        sleep 0.01
+        tries=$((tries + 1))
+    done
+    kill $pid 2> /dev/null
+    wait $pid 2> /dev/null
+    sed -n 's/^qarma trace: *\([0-9]*\).* ms  stdin closed$/\1/p' "$TRACE"
+}
+
+for binary in "$QARMA" $BASELINE; do
+    if [ ! -x "$binary" ]; then
+        echo "$binary is not executable" >&2
+        exit 1
+    fi
+done
+
+seq "$ROWS" | awk '{ print $1 % 100 } END { print 100 }' > "$INPUT"
+printf "%-10s %12s %12s\n" "$ROWS rows" "progress/s" "list/s"
+for binary in "$QARMA" $BASELINE; do
+    printf "%-10s %s %s\n" "$(basename "$binary")" "$(rate "$(progress "$binary")")" "$(rate "$(list "$binary")")"
+done
@@ -0,0 +1,3 @@
+include(../qarma.pri)
+TARGET  = tst_title
+SOURCES = tst_title.cpp
@@ -0,0 +1,140 @@
+/*
+ *   Qarma - a Zenity clone for Qt4 and Qt5
+ *   Copyright 2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#define main qarma_main
+#include "Qarma.cpp"
+#undef main
+
+#include <QtTest>
+#include <QThread>
+#include <QWindow>
+
+// The title used to be put on a throwaway QWindow and copied over by a 10ms timer.
+// It's now set on the dialog before it's shown: the dialog is the only window and
+// is mapped with the right title right away.
+class TitleTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void noThrowawayWindow_data();
+    void noThrowawayWindow();
+    void timeToTitledWindow_data();
+    void timeToTitledWindow();
+};
+
+// argv as main() gets it, the strings must outlive the Qarma instance
+class Arguments
+{
+public:
+    Arguments(const QList<QByteArray> &args) : m_args(args) {
+        for (QByteArray &arg : m_args)
+            m_argv << arg.data();
+        m_argv << nullptr;
+        argc = m_args.count();
+        protectTitle(argc, m_argv.data());
+    }
+    char **argv() { return m_argv.data(); }
+    int argc;
+private:
+    QList<QByteArray> m_args;
+    QVector<char*> m_argv;
+};
+
+static QWindow *dialogWindow()
+{
+    for (QWindow *window : QGuiApplication::topLevelWindows()) {
+        if (window->isVisible())
+            return window;
+    }
+    return nullptr;
+}
+
+void TitleTest::initTestCase()
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+}
+
+void TitleTest::noThrowawayWindow_data()
+{
+    QTest::addColumn<QList<QByteArray>>("args");
+    QTest::newRow("--title=TITLE") << QList<QByteArray>{"qarma", "--info", "--text=x", "--title=Regression title"};
+    QTest::newRow("--title TITLE") << QList<QByteArray>{"qarma", "--info", "--text=x", "--title", "Regression title"};
+    QTest::newRow("--entry") << QList<QByteArray>{"qarma", "--entry", "--title", "Regression title"};
+}
+
+void TitleTest::noThrowawayWindow()
+{
+    QFETCH(QList<QByteArray>, args);
+    Arguments arguments(args);
+    Qarma app(arguments.argc, arguments.argv());
+
+    // no event has been processed yet, so nothing could have fixed the title up
+    int visible = 0;
+    for (QWindow *window : QGuiApplication::topLevelWindows())
+        visible += window->isVisible();
+    QCOMPARE(visible, 1);
+    QCOMPARE(dialogWindow()->title(), QString("Regression title"));
+
+    QTest::qWait(50); // ... and nothing changes it later
+    QCOMPARE(dialogWindow()->title(), QString("Regression title"));
+
+    qDeleteAll(QApplication::topLevelWidgets());
+}
+
+void TitleTest::timeToTitledWindow_data()
+{
+    QTest::addColumn<bool>("legacy");
+    QTest::newRow("direct") << false;
+    QTest::newRow("throwaway window and timer") << true;
+}
+
+// Reports how long the dialog takes to be mapped with its title, against an emulation of the
+// old path which costs another (unmapped) window and the timer.
+void TitleTest::timeToTitledWindow()
+{
+    QFETCH(bool, legacy);
+    const QString title("Regression title");
+    Arguments arguments({"qarma", "--info", "--text=x", "--title", title.toUtf8()});
+    QElapsedTimer timer;
+    timer.start();
+    Qarma app(arguments.argc, arguments.argv());
+    QWindow *window = dialogWindow();
+    QVERIFY(window);
+
+    QWindow throwaway;
+    if (legacy) {
+        window->setTitle(QString());
+        throwaway.create();
+        QTimer::singleShot(10, window, [=]() { window->setTitle(title); });
+    }
+
+    while (!(window->isExposed() && window->title() == title) && timer.elapsed() < 5000) {
+        QCoreApplication::processEvents();
+        QThread::usleep(100);
+    }
+    QVERIFY(window->isExposed());
+    QCOMPARE(window->title(), title);
+    qInfo("%s: %.3f ms until the dialog is mapped with its title", QTest::currentDataTag(), timer.nsecsElapsed()/1.0e6);
+
+    qDeleteAll(QApplication::topLevelWidgets());
+}
+
+QTEST_APPLESS_MAIN(TitleTest)
+#include "tst_title.moc"